@@ -0,0 +1,75 @@
+#!/bin/sh
+# Generate mazes of several sizes and shapes with mazeGen, then time each
+# phase of every solver on them with maze -T.
+#
+#   ./bench.sh [sizes...]        default sizes: 250 500 1000 2000
+#
+# Mazes are written to bench_mazes/ and kept between runs, each as text and
+# as a binary .mzb copy so the two load paths can be compared. Tall and wide
+# mazes of the same area are solved with both the row-major and the tiled
+# (-t) grid layout. One large open maze, LARGE cells a side (default 20000),
+# is solved packed (-c) to keep the search state's footprint in view. Last,
+# two sparse (-z) mazes at the edge of the size limit must finish at once:
+# the tallest allowed, walled beside its last rows, and one a row too tall,
+# which is refused.
+
+set -e
+cd "$(dirname "$0")"
+
+SIZES=${*:-"250 500 1000 2000"}
+OUT=bench_mazes
+LARGE=${LARGE:-20000}
+CC=${CC:-gcc}
+
+$CC -O2 -pthread -o maze main.c
+$CC -O2 -o mazeGen mazeGen.c
+mkdir -p "$OUT"
+
+FILES=""
+SHAPES=""
+for n in $SIZES; do
+    for kind in random open perfect serpentine; do
+        f="$OUT/$kind-$n.txt"
+        if [ ! -f "$f" ]; then
+            ./mazeGen -t "$kind" -x "$n" -y "$n" -w 0.3 -k 0.01 -s "$n" > "$f"
+        fi
+        b="$OUT/$kind-$n.mzb"
+        if [ ! -f "$b" ]; then
+            ./maze -C "$b" "$f" > /dev/null
+        fi
+        FILES="$FILES $f $b"
+    done
+    for shape in "tall $((n * 16)) $((n / 16))" "wide $((n / 16)) $((n * 16))"; do
+        set -- $shape
+        f="$OUT/$1-$n.txt"
+        if [ ! -f "$f" ]; then
+            ./mazeGen -t random -x "$2" -y "$3" -w 0.1 -k 0.01 -s "$n" > "$f"
+        fi
+        SHAPES="$SHAPES $f"
+    done
+done
+
+LARGEFILE="$OUT/open-$LARGE.txt"
+if [ ! -f "$LARGEFILE" ]; then
+    ./mazeGen -t open -x "$LARGE" -y "$LARGE" -k 0 -s "$LARGE" > "$LARGEFILE"
+fi
+
+for solver in "" -b -a -g -M -P; do
+    ./maze -T $solver $FILES
+    echo
+done
+
+for solver in -b -a -M; do
+    ./maze -T $solver $SHAPES
+    ./maze -T -t $solver $SHAPES
+    echo
+done
+
+for solver in "" -b; do
+    ./maze -T -c $solver "$LARGEFILE"
+done
+
+EDGE="$OUT/edge-tallest.txt"
+printf '2147483645 5\n2147483643 1\n2147483645 3\n2147483644 2 b\n' > "$EDGE"
+printf '2147483646 5\n1 1\n3 3\n' > "$OUT/edge-too-tall.txt"
+./maze -T -z "$EDGE" "$OUT/edge-too-tall.txt" || true
@@ -2,404 +2,6029 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 /* This program will read the first 3 lines of input 
     and prints a static 2D maze*/
 
+#define CACHE_LINE 64
+
+/* open-addressed hash set of cell indices, used for coins in a packed maze */
+typedef struct coinSet {
+    uint64_t* keys;     /* cell index + 1; 0 marks an empty slot */
+    size_t count;
+    size_t mask;
+} coinSet;
+
+/* A sparse maze (-z) has no per-cell storage: its walls and coins are one
+   array of cells sorted by row-major index, and the border is implied by
+   the size. While the file is read entries are only appended; sparseSort
+   then orders them, keeping the last line given for each cell. */
+typedef struct sparseCell {
+    uint64_t key;       /* x * (ysize+2) + y */
+    uint32_t line;
+    char type;          /* '*' or 'C' */
+} sparseCell;
+
+typedef struct sparseGrid {
+    sparseCell* cells;
+    size_t count, size;
+} sparseGrid;
+
+/* An out-of-core maze (-D) keeps its grid in a file of tiles, in the
+   tiled layout, and reaches it through a fixed number of cache slots (-K
+   MB), evicting the least recently used tile. A cell is one byte: its type
+   and, while it is searched, a visited bit and the parent direction, so
+   the search state stays out of core along with the grid. */
+#define DISK_WALL 1
+#define DISK_COIN 2
+#define DISK_TYPE 3
+#define DISK_VISITED 4
+#define DISK_PARENT_SHIFT 3
+#define DEFAULT_CACHE_MB 64
+#define NO_SLOT UINT32_MAX
+
+typedef struct tileCache {
+    int fd;
+    size_t slots, used;
+    uint8_t *data;          /* slots x TILE_CELLS bytes */
+    uint64_t *tileOf;       /* tile + 1 held by each slot */
+    bool *dirty;
+    uint32_t *prev, *next;  /* recency list of slots, newest at head */
+    uint32_t head, tail;
+    uint32_t *table;        /* open addressing, tile to slot + 1 */
+    size_t tableMask;
+    uint64_t lastTile;      /* tile + 1 of the last access, which skips the lookup */
+    uint32_t lastSlot;
+    size_t hits, misses;
+    uint64_t bytesRead, bytesWritten;
+} tileCache;
+
+/* Instrumentation for one solved file (-J). Phase times are in seconds. */
+enum runPhase { PHASE_HEADER, PHASE_FILL, PHASE_RENDER, PHASE_SEARCH, PHASE_PATH_OUTPUT, NUM_PHASES };
+
+typedef struct runStats {
+    int xsize, ysize;
+    bool packed;
+    bool tiled;
+    bool sparse;
+    bool disk;
+    size_t tileHits, tileMisses;
+    uint64_t bytesRead, bytesWritten;
+    double phase[NUM_PHASES];
+    size_t obstacles;
+    size_t expanded;
+    size_t backtracks;
+    size_t peakDepth;
+    size_t coinsPicked, coinsDropped;
+    size_t pathLength;
+    size_t bytesAllocated;
+    bool found;
+} runStats;
+
+/* bytes this thread has asked the allocator for; solveFile reports its share */
+static __thread size_t allocBytes;
+
+/* The maze is one contiguous, cache-line aligned buffer of (xsize+2) rows,
+   each row padded out to stride cells. A normal maze stores a char per cell
+   in arr. A packed maze (-c) leaves arr NULL and keeps one wall bit per cell
+   in walls, with the (rare) coins in a hash set. A tiled maze (-t) stores
+   its chars in TILE_SIDE x TILE_SIDE blocks instead, each block one 4 KB
+   page laid out row by row and the blocks themselves in row order, so a
+   move along x stays on the same page unless it crosses a block edge. A
+   sparse maze (-z) leaves arr and walls NULL and keeps only its obstacle
+   list, so its size is bounded by the obstacles rather than the area. An
+   out-of-core maze (-D) is tiled, but its tiles live in a file. */
+#define TILE_SHIFT 6
+#define TILE_SIDE (1 << TILE_SHIFT)
+#define TILE_MASK (TILE_SIDE - 1)
+#define TILE_CELLS (TILE_SIDE * TILE_SIDE)
+
+/* the largest side a maze can have: rows and columns run from the 0 border
+   to side+1, and a search steps one or two past a cell, all in int */
+#define MAZE_MAX_SIDE (INT_MAX - 2)
+
 typedef struct mazeStruct {
-    char** arr;
+    char* arr;
+    uint64_t* walls;
+    coinSet coins;
+    bool packed;
+    bool tiled;
+    bool sparse;
+    sparseGrid obstacles;
+    const char* tileFile;   /* set to keep the grid on disk, in a new file named from this */
+    size_t cacheBytes;
+    tileCache* disk;
+    void* mapBase;      /* set when walls point into a mapped binary maze file */
+    size_t mapLen;
+    FILE* out;          /* where reports about this maze are written */
+    runStats* stats;    /* phase timers, or NULL when not instrumented */
+    size_t stride;
+    size_t tilesAcross; /* blocks per block row when tiled */
     int xsize, ysize;
     int xstart, ystart;
     int xend, yend;
 } maze;
 
-typedef struct node {
+static inline size_t cellIndex(const maze *m1, int x, int y) {
+    if (m1->tiled) {
+        size_t tile = ((size_t)x >> TILE_SHIFT) * m1->tilesAcross + ((size_t)y >> TILE_SHIFT);
+        return tile * TILE_CELLS + (((size_t)x & TILE_MASK) << TILE_SHIFT) + ((size_t)y & TILE_MASK);
+    }
+    return (size_t)x * m1->stride + (size_t)y;
+}
+
+/* size of the index space cellIndex maps into */
+static inline size_t numCells(const maze *m1) {
+    if (m1->tiled) {
+        size_t tilesDown = ((size_t)m1->xsize + 2 + TILE_MASK) >> TILE_SHIFT;
+        return tilesDown * m1->tilesAcross * TILE_CELLS;
+    }
+    return ((size_t)m1->xsize+2) * m1->stride;
+}
+
+/* the row and column of a cell index, the inverse of cellIndex */
+static inline int cellRow(const maze *m1, size_t idx) {
+    if (m1->tiled) {
+        size_t tile = idx / TILE_CELLS;
+        return (int)((tile / m1->tilesAcross) << TILE_SHIFT | ((idx >> TILE_SHIFT) & TILE_MASK));
+    }
+    return (int)(idx / m1->stride);
+}
+
+static inline int cellCol(const maze *m1, size_t idx) {
+    if (m1->tiled) {
+        size_t tile = idx / TILE_CELLS;
+        return (int)((tile % m1->tilesAcross) << TILE_SHIFT | (idx & TILE_MASK));
+    }
+    return (int)(idx % m1->stride);
+}
+
+#define CELL(m1, x, y) ((m1)->arr[cellIndex((m1), (x), (y))])
+
+typedef struct coord {
     int xpos;
     int ypos;
-    struct node* next;
-} node;
+} coord;
 
+/* A path is its first cell plus one 2-bit moveDir per step, 32 steps to a
+   word, with the top cell kept so the search can read it directly. Words are
+   reused across push/pop so a solve only allocates when the path gets
+   longer than ever before. Consecutive cells must be neighbours. */
 typedef struct stack {
-    node* topNode;
+    uint64_t* steps;
+    size_t numItems;    /* cells on the path */
+    size_t size;        /* steps the words can hold */
+    coord first;
+    coord last;         /* the top of the stack */
     int numCoins;
+    size_t expanded;    /* cells the search took off its frontier */
+    size_t expandedEnd; /* of those, the ones a bidirectional search took from the end's side */
+    size_t pops;
+    size_t maxDepth;
+    int coinsDropped;
+    FILE* out;          /* where printReverse writes */
 } stack;
 
-bool checkFile(FILE* src);
+#define STACK_INIT_SIZE 1024
+#define STEPS_PER_WORD 32
+
+/* walks a path's cells from the first; valid while at < numItems */
+typedef struct pathCursor {
+    const stack* path;
+    size_t at;
+    coord cell;
+} pathCursor;
+
+/* Scratch state a search keeps apart from the (read-only) maze, reused from
+   one solve to the next. A cell is visited when its stamp equals epoch, so
+   starting a solve is one increment; the stamps are only cleared when the
+   epoch wraps. A packed maze, whose walls are a bit per cell, gets a
+   visited bit per cell instead of a stamp: a bitmap for each side searched
+   from, cleared at the start of each solve. Parent directions are only read
+   for visited cells, so they are overwritten rather than cleared. */
+typedef struct searchState {
+    uint16_t* stamp;    /* NULL when seen is used */
+    uint64_t* seen;     /* packed mazes: sides bitmaps of cells bits each */
+    uint8_t* parent;    /* 2 bits per cell, see getParentDir */
+    size_t cells;
+    int sides;
+    uint16_t epoch;
+} searchState;
+
+/* which search attemptEscape runs */
+enum solverKind {
+    SOLVE_DFS,
+    SOLVE_BFS,
+    SOLVE_ASTAR,
+    SOLVE_PARALLEL_BFS,
+    SOLVE_JPS,
+    SOLVE_BIDIRECTIONAL,
+    SOLVE_MAX_COINS
+};
+
+typedef struct runOptions {
+    bool debugMode;
+    bool showPath;
+    bool packed;
+    bool tiled;
+    bool sparse;
+    const char *tileFile;
+    size_t cacheBytes;
+    bool batch;
+    bool bench;
+    const char *convertTo;
+    const char *queryFile;
+    const char *socketPath;
+    const char *editFile;
+    const char *traceFile;
+    const char *reportFile;
+    int workers;
+    bool runLengths;
+    bool queryPaths;    /* -Q: list each answer's path after it */
+    bool prefilter;     /* rule out unsolvable mazes with endReachable before searching */
+    long budget;        /* most steps a -m route may take */
+    enum solverKind solver;
+} runOptions;
+
+/* moves in the order attemptMove tries them; a cell's parent direction is
+   the move that entered it, so the parent is one step the opposite way */
+enum moveDir { MOVE_DOWN, MOVE_RIGHT, MOVE_UP, MOVE_LEFT };
+
+static const int dirDx[4] = { 1, 0, -1, 0 };
+static const int dirDy[4] = { 0, 1, 0, -1 };
+
+/* The index of the neighbour one move from idx. Row-major it is a fixed
+   offset; tiled, a move off a block's edge lands on the facing edge of the
+   next block over. */
+static inline size_t stepCell(const maze *m1, size_t idx, int dir) {
+    ptrdiff_t dx = dirDx[dir], dy = dirDy[dir];
+    if (!m1->tiled) {
+        return (size_t)((ptrdiff_t)idx + dx * (ptrdiff_t)m1->stride + dy);
+    }
+    size_t local = dx ? (idx >> TILE_SHIFT) & TILE_MASK : idx & TILE_MASK;
+    if (local != (dx + dy > 0 ? (size_t)TILE_MASK : 0)) {
+        return (size_t)((ptrdiff_t)idx + dx * TILE_SIDE + dy);
+    }
+    return (size_t)((ptrdiff_t)idx + dx * ((ptrdiff_t)m1->tilesAcross * TILE_CELLS - TILE_MASK * TILE_SIDE)
+                                   + dy * (TILE_CELLS - TILE_MASK));
+}
+
+/* Debug trace (-d): push, pop and coin events go into a fixed ring of
+   16-byte records instead of being printed as they happen. A writer claims
+   a slot with one atomic add, so solver threads can share the ring; once it
+   wraps, the oldest events are overwritten. The ring is decoded after the
+   run, or written out raw on SIGUSR1 and decoded later with -R. */
+#define TRACE_RING_SIZE (1 << 18)
+#define TRACE_FILE_MAGIC "MZTR"
+#define TRACE_FILE_VERSION 1
+
+enum traceKind { TRACE_PUSH, TRACE_POP, TRACE_COIN, TRACE_COIN_DROP, TRACE_JUMP, NUM_TRACE_KINDS };
+
+typedef struct traceEvent {
+    uint32_t step;      /* low 32 bits of the event number; tells a filled slot from a stale one */
+    uint32_t kind;
+    int32_t x, y;
+} traceEvent;
+
+typedef struct traceFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t head;      /* events recorded so far */
+    uint64_t capacity;
+} traceFileHeader;
+
+/* Binary maze file (little-endian). The header is followed by the packed
+   wall bitmap exactly as a -c maze holds it in memory, then the coin cell
+   indices. The checksum covers both, so a mapped file can be used in place. */
+#define MAZE_FILE_MAGIC "MAZB"
+#define MAZE_FILE_VERSION 1
+
+typedef struct mazeFileHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t xsize, ysize;
+    int32_t xstart, ystart;
+    int32_t xend, yend;
+    uint64_t stride;        /* cells per row, a multiple of 64 */
+    uint64_t wallWords;
+    uint64_t numCoins;
+    uint64_t checksum;
+} mazeFileHeader;
+
+/* the input file mapped read-only into memory, with a parse cursor */
+typedef struct mazeSource {
+    const char* data;
+    const char* pos;
+    const char* end;
+    size_t len;
+} mazeSource;
+
+/* problems fillMaze can find on an obstacle line, tallied instead of printed per line */
+enum lineError {
+    LINE_OK = 0,
+    LINE_BLOCKS_ENDPOINT,
+    LINE_OUT_OF_RANGE,
+    LINE_BAD_TYPE,
+    LINE_MALFORMED,
+    NUM_LINE_ERRORS
+};
+
+/* output is staged in a fixed buffer and written out in large fwrite calls */
+#define OUTBUF_SIZE (1 << 16)
+
+/* a sparse or out-of-core maze is only drawn when its whole grid is at most this many cells */
+#define SPARSE_DRAW_MAX (1 << 22)
+
+typedef struct outBuf {
+    FILE* out;
+    size_t len;
+    char data[OUTBUF_SIZE];
+} outBuf;
+
+void obInit(outBuf *ob, FILE *out);
+void obFlush(outBuf *ob);
+void obWrite(outBuf *ob, const char *p, size_t n);
+void obInt(outBuf *ob, long v);
+
+bool openSource(const char* fname, mazeSource* src);
+void closeSource(mazeSource* src);
+bool checkFile(mazeSource* src, maze *m1);
 
 stack* init(stack* myStack);
 int is_empty(stack* myStack);
 stack* push(stack* myStack, int xpos, int ypos, bool debugMode);
 stack* pop(stack* myStack, bool debugMode);
-node* top(stack* myStack);
+coord* top(stack* myStack);
 stack* clear(stack* myStack, bool debugMode);
 
 maze* initDynMaze(maze *m1);
-void markBorders(FILE *src, maze *m1);
-void allocateMaze(FILE *src, maze *m1);
-void prepMaze(FILE *src, maze *m1);
-bool errorCheck(maze *m1, int xpos, int ypos);
-void fillMaze(FILE *src, maze *m1);
-void outputMaze(maze *m1, bool debugMode);
-void createMaze(FILE *src, maze *m1, bool debugMode);
-
-void attemptMove(maze *m1, stack* path, bool debugMode);
-int findPath(maze *m1, stack *path, bool debugMode);
-void printReverse(node* topNode);
-void attemptEscape(maze *m1, bool debugMode);
+bool coinAdd(coinSet *set, size_t idx);
+bool coinHas(const coinSet *set, size_t idx);
+void coinRemove(coinSet *set, size_t idx);
+void coinFree(coinSet *set);
+char cellChar(const maze *m1, int x, int y);
+void setCell(maze *m1, int x, int y, char c);
+void markBorders(maze *m1);
+bool allocateMaze(maze *m1);
+bool prepMaze(maze *m1);
+int errorCheck(maze *m1, long xpos, long ypos);
+size_t fillMaze(mazeSource *src, maze *m1);
+void outputMaze(maze *m1);
+void renderMaze(maze *m1, stack *overlay, outBuf *ob);
+bool createMaze(mazeSource *src, maze *m1);
+
+void searchInit(searchState *ss);
+bool searchBegin(searchState *ss, const maze *m1);
+void searchFree(searchState *ss);
+bool attemptMove(const maze *m1, stack* path, searchState *ss, bool debugMode);
+int findPath(const maze *m1, stack *path, searchState *ss, bool debugMode);
+int findPathBFS(const maze *m1, stack *path, searchState *ss);
+int findPathBidirectional(const maze *m1, stack *path, searchState *ss, bool debugMode);
+int findPathCoins(const maze *m1, stack *path, searchState *ss, long budget);
+int findPathSparse(const maze *m1, stack *path, bool debugMode);
+int findPathOutOfCore(const maze *m1, stack *path);
+tileCache *tileCacheOpen(const char *prefix, size_t numTiles, size_t bytes);
+void tileCacheClose(tileCache *tc);
+void sparseSort(sparseGrid *g);
+int findPathAStar(const maze *m1, stack *path, searchState *ss);
+int findPathParallel(const maze *m1, stack *path, searchState *ss, int threads);
+int findPathJPS(const maze *m1, stack *path, searchState *ss);
+bool endReachable(const maze *m1);
+void printReverse(stack* path);
+void printRunLengths(stack* path);
+int solveMaze(const maze *m1, stack *path, searchState *ss, runOptions *opts);
+bool attemptEscape(maze *m1, runOptions *opts);
+void freeGrid(maze *m1);
 void freeMaze(maze *m1);
+bool loadMaze(const char *fname, maze *m1);
+int solveFile(const char *fname, runOptions *opts, FILE *out, runStats *stats);
+bool writeRunReport(FILE *out, const char *fname, runOptions *opts, const runStats *stats);
+int runBatch(char **inputs, int numInputs, runOptions *opts);
+int runBench(char **inputs, int numInputs, runOptions *opts);
+bool isBinaryMaze(const mazeSource *src);
+bool loadBinaryMaze(mazeSource *src, maze *m1);
+bool writeBinaryMaze(maze *m1, const char *fname);
+int convertFile(const char *fname, const char *outName);
+int runQueries(const char *fname, runOptions *opts);
+int runServer(char **inputs, int numInputs, runOptions *opts);
+int applyEdit(maze *m1, long xpos, long ypos, char type, bool remove);
+bool traceOpen(void);
+void traceDecode(const traceEvent *events, uint64_t head, uint64_t capacity, FILE *out);
+void traceFinish(void);
+int decodeTraceFile(const char *fname);
+static double nowSeconds(void);
+static inline double phaseStart(const maze *m1);
+static inline void phaseEnd(const maze *m1, enum runPhase phase, double t0);
+int runEdits(const char *fname, runOptions *opts);
 
 int main (int argc, char **argv) {
-    maze m1;
-    bool debugMode;
-    int xpos, ypos;
-    int i,j,k;
-
-    FILE *src;
+    runOptions opts = { .debugMode = false, .showPath = false, .packed = false,
+                        .batch = false, .workers = 0, .budget = LONG_MAX,
+                        .cacheBytes = (size_t)DEFAULT_CACHE_MB << 20, .solver = SOLVE_DFS };
+    char **inputs = (char**)malloc(sizeof(char*) * (size_t)argc);
+    int numInputs = 0;
+    int i;
 
-    /* verify the proper number of command line arguments were given */
-    if(argc > 3) {
-        printf("Usage: %s <input file name>\n", argv[0]);
+    if (inputs == NULL) {
+        printf("Unable to allocate the input list.\n");
         exit(-1);
     }
-    
-    /* search for debug flag */
+
+    /* search for flags; everything else is an input file (or, in batch mode, a directory) */
     for (i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-d") == 0) {
-            debugMode = true;
-            k = i;
-            break;
+            opts.debugMode = true;
+        } else if (strcmp(argv[i], "-p") == 0) {
+            opts.showPath = true;
+        } else if (strcmp(argv[i], "-b") == 0) {
+            opts.solver = SOLVE_BFS;
+        } else if (strcmp(argv[i], "-a") == 0) {
+            opts.solver = SOLVE_ASTAR;
+        } else if (strcmp(argv[i], "-P") == 0) {
+            opts.solver = SOLVE_PARALLEL_BFS;
+        } else if (strcmp(argv[i], "-g") == 0) {
+            opts.solver = SOLVE_JPS;
+        } else if (strcmp(argv[i], "-M") == 0) {
+            opts.solver = SOLVE_BIDIRECTIONAL;
+        } else if (strcmp(argv[i], "-m") == 0) {
+            opts.solver = SOLVE_MAX_COINS;
+        } else if (strcmp(argv[i], "-l") == 0 && i+1 < argc) {
+            opts.budget = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0) {
+            opts.runLengths = true;
+        } else if (strcmp(argv[i], "-w") == 0) {
+            opts.queryPaths = true;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            opts.prefilter = true;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            opts.packed = true;
+        } else if (strcmp(argv[i], "-t") == 0) {
+            opts.tiled = true;
+        } else if (strcmp(argv[i], "-z") == 0) {
+            opts.sparse = true;
+        } else if (strcmp(argv[i], "-D") == 0 && i+1 < argc) {
+            opts.tileFile = argv[++i];
+        } else if (strcmp(argv[i], "-K") == 0 && i+1 < argc) {
+            opts.cacheBytes = (size_t)atol(argv[++i]) << 20;
+        } else if (strcmp(argv[i], "-B") == 0) {
+            opts.batch = true;
+        } else if (strcmp(argv[i], "-T") == 0) {
+            opts.bench = true;
+        } else if (strcmp(argv[i], "-j") == 0 && i+1 < argc) {
+            opts.workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-C") == 0 && i+1 < argc) {
+            opts.convertTo = argv[++i];
+        } else if (strcmp(argv[i], "-Q") == 0 && i+1 < argc) {
+            opts.queryFile = argv[++i];
+        } else if (strcmp(argv[i], "-S") == 0 && i+1 < argc) {
+            opts.socketPath = argv[++i];
+        } else if (strcmp(argv[i], "-E") == 0 && i+1 < argc) {
+            opts.editFile = argv[++i];
+        } else if (strcmp(argv[i], "-R") == 0 && i+1 < argc) {
+            opts.traceFile = argv[++i];
+        } else if (strcmp(argv[i], "-J") == 0 && i+1 < argc) {
+            opts.reportFile = argv[++i];
+        } else {
+            inputs[numInputs++] = argv[i];
         }
     }
 
-    if (k == 1) {
-        k = 2;
-    } else {
-        k = 1;
+    if (opts.traceFile != NULL && numInputs == 0) {
+        int status = decodeTraceFile(opts.traceFile);
+        free(inputs);
+        return status == 0 ? 0 : 1;
     }
 
-    /* Try to open the input file. */
-    if ( ( src = fopen( argv[k], "r" )) == NULL ) {
-        printf ( "Can't open input file: %s", argv[k] );
+    /* verify the proper command line arguments were given */
+    if (numInputs == 0 || (!opts.batch && !opts.bench && opts.socketPath == NULL && numInputs > 1)) {
+        printf("Usage: %s [-d] [-p] [-r] [-s] [-c | -t] [-J report.json] [-b | -a | -g | -M | -P [-j threads]] <input file name>\n", argv[0]);
+        printf("       %s -m [-l max steps] [options] <input file name>\n", argv[0]);
+        printf("       %s -z [-p] [-r] [-J report.json] <input file name>\n", argv[0]);
+        printf("       %s -D <tile file prefix> [-K cache MB] [-p] [-r] [-J report.json] <input file name>\n", argv[0]);
+        printf("       %s -B [-j workers] [options] <file or directory>...\n", argv[0]);
+        printf("       %s -T [options] <file>...\n", argv[0]);
+        printf("       %s -C <binary output> <input file name>\n", argv[0]);
+        printf("       %s -Q <query file> [-w [-r]] [-c] <input file name>\n", argv[0]);
+        printf("       %s -S <socket> [-j workers] [-c] <file>...\n", argv[0]);
+        printf("       %s -E <edit file> [-p] [-r] [-c] [-b | -a | -g | -M | -P] <input file name>\n", argv[0]);
+        printf("       %s -R <trace dump>\n", argv[0]);
+        free(inputs);
         exit(-1);
     }
-    if (!checkFile(src)) {
-        printf("Invalid data file\n");
+
+    if (opts.debugMode && !traceOpen()) {
+        printf("Unable to allocate the trace ring.\n");
+        free(inputs);
         exit(-1);
     }
-    src = fopen(argv[k], "r");
 
-    // create and fill maze
-    createMaze(src, &m1, debugMode);
+    if (opts.convertTo != NULL) {
+        int status = convertFile(inputs[0], opts.convertTo);
+        free(inputs);
+        return status == 0 ? 0 : 1;
+    }
 
-    /*Close the file*/
-    fclose(src);
-        
-    // output maze
-    outputMaze(&m1, debugMode);
+    if (opts.queryFile != NULL) {
+        /* -p means drawing the path over the maze, which -Q never prints */
+        if (opts.showPath) {
+            printf("-Q lists query paths with -w, not -p.\n");
+            free(inputs);
+            return 1;
+        }
+        int status = runQueries(inputs[0], &opts);
+        free(inputs);
+        return status == 0 ? 0 : 1;
+    }
 
-    // attempt to escape the maze
-    attemptEscape(&m1, debugMode);
+    if (opts.editFile != NULL) {
+        int status = runEdits(inputs[0], &opts);
+        traceFinish();
+        free(inputs);
+        return status == 0 ? 0 : 1;
+    }
 
-    // free maze
-    freeMaze(&m1);
+    if (opts.socketPath != NULL) {
+        int status = runServer(inputs, numInputs, &opts);
+        free(inputs);
+        return status == 0 ? 0 : 1;
+    }
 
+    if (opts.bench) {
+        int failed = runBench(inputs, numInputs, &opts);
+        free(inputs);
+        return failed > 0 ? 1 : 0;
+    }
+
+    if (opts.batch) {
+        int failed = runBatch(inputs, numInputs, &opts);
+        traceFinish();
+        free(inputs);
+        return failed > 0 ? 1 : 0;
+    }
+
+    runStats stats;
+    int status = solveFile(inputs[0], &opts, stdout, opts.reportFile ? &stats : NULL);
+    traceFinish();
+    free(inputs);
+    if (status != 0) {
+        exit(-1);
+    }
+    return 0;
 }
 
-bool checkFile(FILE* src) {
-    char c = 'z';
-    int numLines = 0;
-    while (c != EOF) {
-        c = getc(src);
-        if (c == '\n') {
-            numLines++;
+/* Read a text or binary maze file into m1, whose packed and out fields
+   are already set. Problems are reported to m1->out. */
+bool loadMaze(const char *fname, maze *m1) {
+    mazeSource src;
+    double t0 = phaseStart(m1);
+
+    /* Try to open the input file. */
+    if (!openSource(fname, &src)) {
+        fprintf (m1->out, "Can't open input file: %s", fname );
+        return false;
+    }
+
+    bool created;
+    if (isBinaryMaze(&src) && (m1->sparse || m1->tileFile != NULL)) {
+        fprintf(m1->out, "A binary maze is a packed bitmap and can't be loaded %s.\n",
+                m1->sparse ? "sparse (-z)" : "into tiles on disk (-D)");
+        created = false;
+    } else if (isBinaryMaze(&src)) {
+        // a binary maze is used straight from the mapping
+        created = loadBinaryMaze(&src, m1);
+        if (!created) {
+            fprintf(m1->out, "Invalid data file\n");
         }
-        if (numLines == 3) {
-            fclose(src);
-            return true;
+        phaseEnd(m1, PHASE_HEADER, t0);
+    } else {
+        bool valid = checkFile(&src, m1);
+        phaseEnd(m1, PHASE_HEADER, t0);
+        if (!valid) {
+            fprintf(m1->out, "Invalid data file\n");
+            closeSource(&src);
+            return false;
         }
-    }
-    
-    fclose(src);
-    return false;
-}
 
-// stack related =============================================================
+        // create and fill maze
+        created = createMaze(&src, m1);
+    }
 
-stack* init(stack* myStack) {
-    myStack->topNode = NULL;
-    myStack->numCoins = 0;
-    return myStack;
+    /*Close the file*/
+    closeSource(&src);
+    return created;
 }
 
-int is_empty(stack* myStack) {
-    if (myStack->topNode == NULL)
-        return 1;
-    else
-        return 0;
-}
+/* Load, print and solve one maze file, writing everything to out.
+   Returns -1 if the file could not be used or the search ran out of
+   memory. Running out while loading (the coin set, obstacle list or tile
+   cache) or failing to read or write the tile file still ends the process,
+   batch workers included. */
+int solveFile(const char *fname, runOptions *opts, FILE *out, runStats *stats) {
+    maze m1;
+    size_t allocatedBefore = allocBytes;
 
-stack* push(stack* myStack, int xpos, int ypos, bool debugMode) {
-    node* new = (node*)malloc(sizeof(node));
-    new->xpos = xpos;
-    new->ypos = ypos;
+    memset(&m1, 0, sizeof(m1));
+    m1.packed = opts->packed;
+    m1.tiled = opts->tiled;
+    m1.sparse = opts->sparse;
+    m1.tileFile = opts->tileFile;
+    m1.cacheBytes = opts->cacheBytes;
+    m1.out = out;
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+        m1.stats = stats;
+    }
+    if (!loadMaze(fname, &m1)) {
+        return -1;
+    }
+        
+    // output maze
+    double t0 = phaseStart(&m1);
+    outputMaze(&m1);
+    phaseEnd(&m1, PHASE_RENDER, t0);
 
-    if (myStack->topNode == NULL) {
-        new->next = NULL;
-    } else {
-        new->next = myStack->topNode;
+    // attempt to escape the maze
+    if (!attemptEscape(&m1, opts)) {
+        freeMaze(&m1);
+        return -1;
     }
 
-    myStack->topNode = new;
-    if (debugMode) {
-        printf("(%d, %d) pushed into the stack.\n", new->xpos, new->ypos);
+    if (stats != NULL) {
+        stats->xsize = m1.xsize;
+        stats->ysize = m1.ysize;
+        stats->packed = (m1.walls != NULL);
+        stats->tiled = m1.tiled;
+        stats->sparse = m1.sparse;
+        if (m1.disk != NULL) {
+            stats->disk = true;
+            stats->tileHits = m1.disk->hits;
+            stats->tileMisses = m1.disk->misses;
+            stats->bytesRead = m1.disk->bytesRead;
+            stats->bytesWritten = m1.disk->bytesWritten;
+        }
+        stats->bytesAllocated = allocBytes - allocatedBefore;
+        if (opts->reportFile != NULL && !opts->batch) {
+            FILE *report = strcmp(opts->reportFile, "-") == 0 ? stdout : fopen(opts->reportFile, "w");
+            if (report == NULL || !writeRunReport(report, fname, opts, stats)) {
+                fprintf(out, "Can't write report file: %s\n", opts->reportFile);
+            }
+            if (report != NULL && report != stdout) {
+                fclose(report);
+            }
+        }
     }
 
-    return myStack;
+    // free maze
+    freeMaze(&m1);
+    return 0;
 }
 
-stack* pop(stack* myStack, bool debugMode) {
-    node* temp = myStack->topNode;
-    myStack->topNode = myStack->topNode->next;
+// input related =============================================================
 
-    if (debugMode) {
-        printf("(%d, %d) popped off the stack.\n", temp->xpos, temp->ypos);
+bool openSource(const char* fname, mazeSource* src) {
+    struct stat st;
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
     }
 
-    free(temp);
+    src->len = (size_t)st.st_size;
+    src->data = NULL;
+    if (src->len > 0) {
+        void* p = mmap(NULL, src->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        madvise(p, src->len, MADV_SEQUENTIAL);
+        src->data = (const char*)p;
+    }
+    close(fd);
 
-    return myStack;
+    src->pos = src->data;
+    src->end = src->data + src->len;
+    return true;
 }
 
-node* top(stack* myStack) {
-    return myStack->topNode;
+/* closing after loadBinaryMaze is harmless: the maze took over the mapping */
+void closeSource(mazeSource* src) {
+    if (src->data != NULL) {
+        munmap((void*)src->data, src->len);
+    }
+    src->data = src->pos = src->end = NULL;
+    src->len = 0;
 }
 
-stack* clear(stack* myStack, bool debugMode) {
-    while (!is_empty(myStack)) {
-        pop(myStack, debugMode);
+static inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
     }
-    myStack->topNode = NULL;
-    return myStack;
+    return p;
 }
 
-// maze related ==============================================================
+/* Number of leading ASCII digits in the 8 bytes of chunk (first byte in the low bits).
+   A byte is a digit when its high nibble is 3 both before and after adding 6. */
+static inline int leadingDigits(uint64_t chunk) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    uint64_t hi = chunk & (0xF0 * ones);
+    uint64_t hi6 = (chunk + 0x06 * ones) & (0xF0 * ones);
+    uint64_t bad = (hi ^ (0x30 * ones)) | (hi6 ^ (0x30 * ones));
+    /* set the top bit of every non-zero byte */
+    bad = (((bad & (0x7F * ones)) + (0x7F * ones)) | bad) & (0x80 * ones);
+    return bad == 0 ? 8 : __builtin_ctzll(bad) >> 3;
+}
 
-maze* initDynMaze(maze *m1) {
-    int xsize = m1->xsize+2;
-    int ysize = m1->ysize+2;
-    m1->arr = (char**)malloc(sizeof(char*)*xsize);
-    for (int i = 0; i < m1->xsize+2; i++) {
-        m1->arr[i] = (char*)malloc(sizeof(char)*ysize);
-    }
-    return m1;
+/* Value of the first n (1..8) digits of chunk: left-pad with zeros, then
+   combine byte pairs, pairs of pairs, and the two halves with three multiplies. */
+static inline uint64_t swarDigits(uint64_t chunk, int n) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 100 + (1000000ULL << 32);
+    const uint64_t mul2 = 1 + (10000ULL << 32);
+    uint64_t val = (chunk - 0x3030303030303030ULL) << (8 * (8 - n));
+    val = (val * 10) + (val >> 8);
+    return (((val & mask) * mul1) + (((val >> 16) & mask) * mul2)) >> 32;
 }
 
-void markBorders(FILE *src, maze *m1) {
-    int i;
-    for (i=0; i < m1->xsize+2; i++) {
-        m1->arr[i][0] = '*';
-        m1->arr[i][m1->ysize+1] = '*';
+/* Parse an optionally signed decimal at *pp. Values too large for a maze
+   coordinate saturate rather than overflow; errorCheck rejects them later. */
+static bool scanInt(const char** pp, const char* end, long* out) {
+    static const uint64_t pow10[9] = {1, 10, 100, 1000, 10000, 100000,
+                                      1000000, 10000000, 100000000};
+    const char* p = skipBlanks(*pp, end);
+    bool neg = false;
+    uint64_t val = 0;
+    int digits = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        p++;
     }
-    for (i=0; i < m1->ysize+2; i++) {
-        m1->arr[0][i] = '*';
-        m1->arr[m1->xsize+1][i] = '*';
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - p >= 8) {
+        uint64_t chunk;
+        memcpy(&chunk, p, sizeof(chunk));
+        int n = leadingDigits(chunk);
+        if (n == 0) {
+            break;
+        }
+        val = val * pow10[n] + swarDigits(chunk, n);
+        if (val > INT32_MAX) {
+            val = (uint64_t)INT32_MAX + 1;
+        }
+        digits += n;
+        p += n;
+        if (n < 8) {
+            break;
+        }
     }
-    for (i=0; i < m1->xsize+2; i++) {
-        m1->arr[i][0] = '*';
-        m1->arr[i][m1->ysize+1] = '*';
+#endif
+    while (p < end && (unsigned)(*p - '0') < 10) {
+        val = val * 10 + (uint64_t)(*p - '0');
+        if (val > INT32_MAX) {
+            val = (uint64_t)INT32_MAX + 1;
+        }
+        digits++;
+        p++;
     }
-    for (i=0; i < m1->ysize+2; i++) {
-        m1->arr[0][i] = '*';
-        m1->arr[m1->xsize+1][i] = '*';
+
+    if (digits == 0) {
+        return false;
     }
+    *out = neg ? -(long)val : (long)val;
+    *pp = p;
+    return true;
 }
 
-void allocateMaze(FILE *src, maze *m1) {
-    int xpos, ypos;
+/* Move past the rest of the current line, using memchr to find the newline. */
+static inline const char* nextLine(const char* p, const char* end) {
+    const char* nl = (const char*)memchr(p, '\n', (size_t)(end - p));
+    return nl == NULL ? end : nl + 1;
+}
 
-    /* read in first 3 lines of file */
-    fscanf(src, "%d %d", &m1->xsize, &m1->ysize);
-    if (m1->xsize < 1 || m1->ysize < 1) {
-        printf("Maze sizes must be greater than 0.\n");
-        exit(-1);
+/* reads a header line of two integers */
+static bool scanPair(mazeSource* src, long* a, long* b) {
+    const char* p = src->pos;
+    const char* nl = (const char*)memchr(p, '\n', (size_t)(src->end - p));
+    if (nl == NULL || !scanInt(&p, nl, a) || !scanInt(&p, nl, b)) {
+        return false;
     }
-    printf ("size: %d, %d\n", m1->xsize, m1->ysize);
+    src->pos = nl + 1;
+    return true;
+}
 
-    initDynMaze(m1);
+static int clampCoord(long v) {
+    if (v > INT32_MAX) return INT32_MAX;
+    if (v < INT32_MIN) return INT32_MIN;
+    return (int)v;
+}
 
-    fscanf (src, "%d %d", &m1->xstart, &m1->ystart);
-    if (m1->xstart < 1 || m1->xstart > m1->xsize || m1->ystart < 1 || m1->ystart > m1->ysize) {
-        printf("Start/End position outside of maze range\n");
-        exit(-1);
+/* Validate the 3 header lines and read them into the maze in the same pass;
+   leaves the cursor at the first obstacle line. */
+bool checkFile(mazeSource* src, maze *m1) {
+    long v[6];
+    if (src->data == NULL) {
+        return false;
     }
-    printf ("start: %d, %d\n", m1->xstart, m1->ystart);
-
-    fscanf (src, "%d %d", &m1->xend, &m1->yend);
-    if (m1->xend < 1 || m1->xend > m1->xsize || m1->yend < 1 || m1->yend > m1->ysize) {
-        printf("Start/End position outside of maze range\n");
-        exit(-1);
+    for (int line = 0; line < 3; line++) {
+        if (!scanPair(src, &v[2*line], &v[2*line+1])) {
+            return false;
+        }
     }
-    printf ("end: %d, %d\n", m1->xend, m1->yend);
 
+    m1->xsize = clampCoord(v[0]);
+    m1->ysize = clampCoord(v[1]);
+    m1->xstart = clampCoord(v[2]);
+    m1->ystart = clampCoord(v[3]);
+    m1->xend = clampCoord(v[4]);
+    m1->yend = clampCoord(v[5]);
+    return true;
 }
 
-void prepMaze(FILE *src, maze *m1) {
-    int i, j;
-
-    allocateMaze(src, m1);
+// output related ============================================================
 
+void obInit(outBuf *ob, FILE *out) {
+    ob->out = out;
+    ob->len = 0;
+}
 
-    /* initialize the maze to empty */
-    for (i = 0; i < m1->xsize+2; i++) {
-        for (j = 0; j < m1->ysize+2; j++) {
-            m1->arr[i][j] = '.';
-        }
+void obFlush(outBuf *ob) {
+    if (ob->len > 0) {
+        fwrite(ob->data, 1, ob->len, ob->out);
+        ob->len = 0;
     }
+}
 
-    markBorders(src, m1);
+static inline void obPutc(outBuf *ob, char c) {
+    if (ob->len == OUTBUF_SIZE) {
+        obFlush(ob);
+    }
+    ob->data[ob->len++] = c;
 }
 
-bool errorCheck(maze *m1, int xpos, int ypos) {
-    if (xpos == m1->xstart && ypos == m1->ystart) {
-        printf("Invalid coordinates: attempting to block start/end position.\n");
-        return true;
-    } else if (xpos == m1->xend && ypos == m1->yend) {
-        printf("Invalid coordinates: attempting to block start/end position.\n");
-        return true;
-    } else if (xpos > m1->xsize || xpos < 1 || ypos > m1->ysize || ypos < 1) {
-        printf("Invalid coordinates: outside of maze range.\n");
-        return true;
+void obWrite(outBuf *ob, const char *p, size_t n) {
+    if (ob->len + n > OUTBUF_SIZE) {
+        obFlush(ob);
+        /* anything at least as large as the buffer goes straight out */
+        if (n >= OUTBUF_SIZE) {
+            fwrite(p, 1, n, ob->out);
+            return;
+        }
     }
+    memcpy(ob->data + ob->len, p, n);
+    ob->len += n;
+}
 
-    return false;
+/* integer to text two digits at a time, without going through printf */
+void obInt(outBuf *ob, long v) {
+    static const char digitPairs[201] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char tmp[24];
+    char *p = tmp + sizeof(tmp);
+    unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;
+
+    while (u >= 100) {
+        unsigned long r = u % 100;
+        u /= 100;
+        p -= 2;
+        memcpy(p, &digitPairs[2*r], 2);
+    }
+    if (u >= 10) {
+        p -= 2;
+        memcpy(p, &digitPairs[2*u], 2);
+    } else {
+        *--p = (char)('0' + u);
+    }
+    if (v < 0) {
+        *--p = '-';
+    }
+    obWrite(ob, p, (size_t)(tmp + sizeof(tmp) - p));
 }
 
-void fillMaze(FILE *src, maze *m1) {
-    int xpos, ypos;
-    char c;
+// instrumentation ===========================================================
 
-    /* mark the starting and ending positions in the maze */
-    m1->arr[m1->xstart][m1->ystart] = 's';
-    m1->arr[m1->xend][m1->yend] = 'e';
+static inline void countAlloc(size_t bytes) {
+    allocBytes += bytes;
+}
 
-    while (fscanf(src, "%d %d %c", &xpos, &ypos, &c) != EOF) {
-        bool dontAdd = false;
-        if (errorCheck(m1, xpos, ypos)) {
-            dontAdd = true;
-        }
+/* phase timers are only read when the maze is instrumented */
+static inline double phaseStart(const maze *m1) {
+    return m1->stats != NULL ? nowSeconds() : 0.0;
+}
 
-        switch (c) {
-            case 'c' :
-                c = 'C';
-                break;
-            case 'b' :
-                c = '*';
-                break;
-            default :
-                printf("Invalid type: type is not recognized.\n");
-                dontAdd = true;
-        }
+static inline void phaseEnd(const maze *m1, enum runPhase phase, double t0) {
+    if (m1->stats != NULL) {
+        m1->stats->phase[phase] += nowSeconds() - t0;
+    }
+}
 
-        if (!dontAdd) {
-            m1->arr[xpos][ypos] = c;
+static void writeJsonString(FILE *out, const char *str) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char*)str; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(out, "\\u%04x", *p);
+        } else {
+            fputc(*p, out);
         }
     }
+    fputc('"', out);
 }
 
-void outputMaze(maze *m1, bool debugMode) {
-    int i, j;
+/* one JSON object describing a solved file; returns false if the write failed */
+bool writeRunReport(FILE *out, const char *fname, runOptions *opts, const runStats *stats) {
+    static const char* solverName[] = { "dfs", "bfs", "astar", "parallel", "jps", "bidir", "coins" };
+    static const char* phaseName[NUM_PHASES] = {
+        [PHASE_HEADER] = "header", [PHASE_FILL] = "fill", [PHASE_RENDER] = "render",
+        [PHASE_SEARCH] = "search", [PHASE_PATH_OUTPUT] = "path_output",
+    };
 
-    /* print out the initial maze */
-    for (i = 0; i < m1->xsize+2; i++) {
-        for (j = 0; j < m1->ysize+2; j++)
-        printf ("%c", m1->arr[i][j]);
-        printf("\n");
+    fprintf(out, "{\"file\": ");
+    writeJsonString(out, fname);
+    fprintf(out, ", \"solver\": \"%s\", \"packed\": %s, \"tiled\": %s, \"sparse\": %s, \"xsize\": %d, \"ysize\": %d, \"found\": %s,\n",
+            stats->sparse ? "sparse" : stats->disk ? "disk" : solverName[opts->solver], stats->packed ? "true" : "false",
+            stats->tiled ? "true" : "false", stats->sparse ? "true" : "false",
+            stats->xsize, stats->ysize, stats->found ? "true" : "false");
+    fprintf(out, " \"phase_seconds\": {");
+    for (int i = 0; i < NUM_PHASES; i++) {
+        fprintf(out, "%s\"%s\": %.9f", i ? ", " : "", phaseName[i], stats->phase[i]);
+    }
+    fprintf(out, "},\n \"counters\": {\"obstacle_lines\": %zu, \"nodes_expanded\": %zu, \"backtracks\": %zu, "
+            "\"peak_stack_depth\": %zu, \"coins_picked\": %zu, \"coins_dropped\": %zu, "
+            "\"path_length\": %zu, \"bytes_allocated\": %zu}",
+            stats->obstacles, stats->expanded, stats->backtracks, stats->peakDepth,
+            stats->coinsPicked, stats->coinsDropped, stats->pathLength, stats->bytesAllocated);
+    if (stats->disk) {
+        fprintf(out, ",\n \"tile_cache\": {\"hits\": %zu, \"misses\": %zu, \"bytes_read\": %llu, \"bytes_written\": %llu}",
+                stats->tileHits, stats->tileMisses,
+                (unsigned long long)stats->bytesRead, (unsigned long long)stats->bytesWritten);
     }
+    fprintf(out, "}\n");
+    return !ferror(out);
 }
 
-void createMaze(FILE *src, maze *m1, bool debugMode) {
-    prepMaze(src, m1);
-    fillMaze(src, m1);
+// trace ring ================================================================
+
+static traceEvent *traceEvents;
+static uint64_t traceHead;
+static char traceDumpName[64];
+
+static inline void traceRecord(enum traceKind kind, int x, int y) {
+    uint64_t n = __atomic_fetch_add(&traceHead, 1, __ATOMIC_RELAXED);
+    traceEvent *e = &traceEvents[n & (TRACE_RING_SIZE-1)];
+    e->kind = (uint32_t)kind;
+    e->x = x;
+    e->y = y;
+    __atomic_store_n(&e->step, (uint32_t)n, __ATOMIC_RELEASE);
 }
 
-// related to finding exit to maze ============================================
+/* write the ring out raw, using only calls that are safe in a signal handler */
+static void traceDump(int signo) {
+    traceFileHeader hdr;
+    int fd = open(traceDumpName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    (void)signo;
 
-void attemptMove(maze *m1, stack* path,  bool debugMode) {
-    int xCurr = top(path)->xpos;
-    int yCurr = top(path)->ypos;
+    if (fd < 0) {
+        return;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TRACE_FILE_MAGIC, 4);
+    hdr.version = TRACE_FILE_VERSION;
+    hdr.head = __atomic_load_n(&traceHead, __ATOMIC_RELAXED);
+    hdr.capacity = TRACE_RING_SIZE;
+    if (write(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr)) {
+        const char *p = (const char*)traceEvents;
+        size_t left = sizeof(traceEvent) * TRACE_RING_SIZE;
+        while (left > 0) {
+            ssize_t put = write(fd, p, left);
+            if (put <= 0) {
+                break;
+            }
+            p += put;
+            left -= (size_t)put;
+        }
+    }
+    close(fd);
+}
+
+/* start tracing; kill -USR1 <pid> writes the ring to maze-trace.<pid>.bin */
+bool traceOpen(void) {
+    struct sigaction sa;
 
-    if (m1->arr[xCurr+1][yCurr] != '*') {
-        xCurr++;
-        push(path, xCurr, yCurr, debugMode);
-    } else if (m1->arr[xCurr][yCurr+1] != '*') {
-        yCurr++;
-        push(path, xCurr, yCurr, debugMode);
+    traceEvents = (traceEvent*)calloc(TRACE_RING_SIZE, sizeof(traceEvent));
+    if (traceEvents == NULL) {
+        return false;
+    }
+    /* slot 0 would otherwise look like event 0 before anything is recorded */
+    traceEvents[0].step = UINT32_MAX;
+    snprintf(traceDumpName, sizeof(traceDumpName), "maze-trace.%ld.bin", (long)getpid());
 
-    } else if (m1->arr[xCurr-1][yCurr] != '*') {
-        xCurr--;
-        push(path, xCurr, yCurr, debugMode);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = traceDump;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+    return true;
+}
 
-    } else if (m1->arr[xCurr][yCurr-1] != '*') {
-        yCurr--;
-        push(path, xCurr, yCurr, debugMode);
+/* Print the events still in the ring, oldest first. Slots whose step does
+   not match were overwritten or were still being written, and are skipped. */
+void traceDecode(const traceEvent *events, uint64_t head, uint64_t capacity, FILE *out) {
+    static const char *what[NUM_TRACE_KINDS] = {
+        [TRACE_PUSH] = "pushed into the stack.",
+        [TRACE_POP] = "popped off the stack.",
+        [TRACE_COIN] = "coin picked up.",
+        [TRACE_COIN_DROP] = "coin dropped.",
+        [TRACE_JUMP] = "expanded as a jump point.",
+    };
+    uint64_t first = head > capacity ? head - capacity : 0;
 
-    } else {
-        if (m1->arr[top(path)->xpos][top(path)->ypos] == 'c') {
-            path->numCoins--;
-            m1->arr[xCurr][yCurr] == '*';
+    if (first > 0) {
+        fprintf(out, "(%llu earlier events were overwritten)\n", (unsigned long long)first);
+    }
+    for (uint64_t n = first; n < head; n++) {
+        const traceEvent *e = &events[n & (capacity-1)];
+        if (e->step != (uint32_t)n || e->kind >= NUM_TRACE_KINDS) {
+            continue;
         }
-        pop(path, debugMode);
+        fprintf(out, "%llu: (%d, %d) %s\n", (unsigned long long)n, e->x, e->y, what[e->kind]);
     }
+}
 
-    if (m1->arr[xCurr][yCurr] == 'C') {
-        path->numCoins += 1;
+/* decode the ring to stdout after a traced run */
+void traceFinish(void) {
+    if (traceEvents == NULL) {
+        return;
     }
-    m1->arr[xCurr][yCurr] = '*';
+    fflush(stdout);
+    traceDecode(traceEvents, traceHead, TRACE_RING_SIZE, stdout);
+    free(traceEvents);
+    traceEvents = NULL;
 }
 
-int findPath(maze *m1, stack *path, bool debugMode) {
-    push(path, m1->xstart, m1->ystart, debugMode);
-    while (top(path)->xpos != m1->xend || top(path)->ypos != m1->yend) {
-        attemptMove(m1, path, debugMode);
-        if (is_empty(path)) {
-            return 0;
-        }
+/* decode a ring written by SIGUSR1 */
+int decodeTraceFile(const char *fname) {
+    mazeSource src;
+
+    if (!openSource(fname, &src)) {
+        printf("Can't open trace file: %s\n", fname);
+        return -1;
     }
-    
-    return 1;
+    const traceFileHeader *hdr = (const traceFileHeader*)src.data;
+    if (src.len < sizeof(*hdr) || memcmp(hdr->magic, TRACE_FILE_MAGIC, 4) != 0
+        || hdr->version != TRACE_FILE_VERSION || hdr->capacity == 0
+        || (hdr->capacity & (hdr->capacity-1)) != 0
+        || src.len != sizeof(*hdr) + hdr->capacity * sizeof(traceEvent)) {
+        printf("Invalid trace file: %s\n", fname);
+        closeSource(&src);
+        return -1;
+    }
+    traceDecode((const traceEvent*)(src.data + sizeof(*hdr)), hdr->head, hdr->capacity, stdout);
+    closeSource(&src);
+    return 0;
 }
 
-void printReverse(node* topNode) {
-    if (topNode == NULL) {
-        return;
+// stack related =============================================================
+
+stack* init(stack* myStack) {
+    myStack->steps = NULL;
+    myStack->numItems = 0;
+    myStack->size = 0;
+    myStack->numCoins = 0;
+    myStack->expanded = 0;
+    myStack->expandedEnd = 0;
+    myStack->pops = 0;
+    myStack->maxDepth = 0;
+    myStack->coinsDropped = 0;
+    myStack->out = stdout;
+    return myStack;
+}
+
+int is_empty(stack* myStack) {
+    if (myStack->numItems == 0)
+        return 1;
+    else
+        return 0;
+}
+
+/* make room for at least steps moves; false, with the stack unchanged, if it can't grow */
+static bool reserveSteps(stack* myStack, size_t steps) {
+    size_t newSize = myStack->size ? myStack->size : STACK_INIT_SIZE;
+    while (newSize < steps) {
+        newSize *= 2;
     }
-    
-    printReverse(topNode->next);
-    printf("(%d,%d) ", topNode->xpos, topNode->ypos);
+    if (newSize == myStack->size) {
+        return true;
+    }
+    uint64_t* newSteps = (uint64_t*)realloc(myStack->steps, sizeof(uint64_t) * (newSize / STEPS_PER_WORD));
+    if (newSteps == NULL) {
+        return false;
+    }
+    countAlloc(sizeof(uint64_t) * ((newSize - myStack->size) / STEPS_PER_WORD));
+    myStack->steps = newSteps;
+    myStack->size = newSize;
+    return true;
 }
 
-void attemptEscape(maze *m1, bool debugMode) {
-    stack path;
-    init(&path);
-    if (findPath(m1, &path, debugMode) == 1) {
-        printf("The maze has a solution.\n");
-        printf("The amount of coins collected: %d\n", path.numCoins);
-        printf("The path from start to end: \n");
-        printReverse(top(&path));
-        printf("\n");
+/* the move from cell i of the path to cell i+1 */
+static inline int stepDir(const stack* myStack, size_t i) {
+    return (int)(myStack->steps[i / STEPS_PER_WORD] >> (i % STEPS_PER_WORD * 2) & 3);
+}
+
+static inline void setStepDir(stack* myStack, size_t i, int dir) {
+    uint64_t* word = &myStack->steps[i / STEPS_PER_WORD];
+    unsigned shift = (unsigned)(i % STEPS_PER_WORD * 2);
+    *word = (*word & ~(3ULL << shift)) | (uint64_t)dir << shift;
+}
 
+/* returns NULL, with the stack unchanged, if it could not grow */
+stack* push(stack* myStack, int xpos, int ypos, bool debugMode) {
+    if (myStack->numItems == 0) {
+        myStack->first.xpos = xpos;
+        myStack->first.ypos = ypos;
     } else {
-        printf("This maze has no solution.\n");
-        return;
+        int dx = xpos - myStack->last.xpos, dy = ypos - myStack->last.ypos;
+        if (abs(dx) + abs(dy) != 1) {
+            printf("Path step from (%d, %d) to (%d, %d) is not a move.\n",
+                   myStack->last.xpos, myStack->last.ypos, xpos, ypos);
+            exit(-1);
+        }
+        if (myStack->numItems > myStack->size && !reserveSteps(myStack, myStack->numItems)) {
+            return NULL;
+        }
+        setStepDir(myStack, myStack->numItems-1, dx ? (dx > 0 ? MOVE_DOWN : MOVE_UP) : (dy > 0 ? MOVE_RIGHT : MOVE_LEFT));
+    }
+    myStack->last.xpos = xpos;
+    myStack->last.ypos = ypos;
+    myStack->numItems++;
+    if (myStack->numItems > myStack->maxDepth) {
+        myStack->maxDepth = myStack->numItems;
     }
 
-    clear(&path, debugMode);
+    if (debugMode) {
+        traceRecord(TRACE_PUSH, xpos, ypos);
+    }
+
+    return myStack;
 }
 
-void freeMaze(maze *m1) {
-    for (int i = 0; i < m1->xsize+2; i++) {
-        free(m1->arr[i]);
+stack* pop(stack* myStack, bool debugMode) {
+    coord temp = myStack->last;
+    myStack->pops++;
+
+    /* step back against the move that entered the top cell */
+    if (--myStack->numItems > 0) {
+        int dir = stepDir(myStack, myStack->numItems-1);
+        myStack->last.xpos -= dirDx[dir];
+        myStack->last.ypos -= dirDy[dir];
     }
-    free(m1->arr);
-}
\ No newline at end of file
+
+    if (debugMode) {
+        traceRecord(TRACE_POP, temp.xpos, temp.ypos);
+    }
+
+    return myStack;
+}
+
+coord* top(stack* myStack) {
+    if (myStack->numItems == 0) {
+        return NULL;
+    }
+    return &myStack->last;
+}
+
+/* empties the stack and releases its storage */
+stack* clear(stack* myStack, bool debugMode) {
+    if (debugMode) {
+        while (!is_empty(myStack)) {
+            pop(myStack, debugMode);
+        }
+    }
+    free(myStack->steps);
+    return init(myStack);
+}
+
+static inline void pathBegin(pathCursor *c, const stack *path) {
+    c->path = path;
+    c->at = 0;
+    c->cell = path->first;
+}
+
+static inline void pathNext(pathCursor *c) {
+    if (c->at + 1 < c->path->numItems) {
+        int dir = stepDir(c->path, c->at);
+        c->cell.xpos += dirDx[dir];
+        c->cell.ypos += dirDy[dir];
+    }
+    c->at++;
+}
+
+// maze related ==============================================================
+
+maze* initDynMaze(maze *m1) {
+    size_t xsize = (size_t)m1->xsize+2;
+    size_t ysize = (size_t)m1->ysize+2;
+
+    m1->arr = NULL;
+    m1->walls = NULL;
+    memset(&m1->coins, 0, sizeof(m1->coins));
+    memset(&m1->obstacles, 0, sizeof(m1->obstacles));
+    m1->disk = NULL;
+    m1->packed = m1->packed && !m1->sparse && m1->tileFile == NULL;
+    m1->tiled = (m1->tiled && !m1->packed && !m1->sparse) || (m1->tileFile != NULL && !m1->sparse);
+
+    if (m1->sparse) {
+        /* nothing per cell; cellIndex is plain row-major over the bordered grid */
+        m1->stride = ysize;
+        return m1;
+    } else if (m1->tileFile != NULL) {
+        /* the tiled layout, with the tiles in a file */
+        m1->tilesAcross = (ysize + TILE_MASK) >> TILE_SHIFT;
+        m1->stride = m1->tilesAcross * TILE_SIDE;
+        m1->disk = tileCacheOpen(m1->tileFile, numCells(m1) / TILE_CELLS, m1->cacheBytes);
+        if (m1->disk == NULL) {
+            fprintf(m1->out, "Unable to set up a tile file at %s.XXXXXX for a %d x %d maze.\n",
+                    m1->tileFile, m1->xsize, m1->ysize);
+        }
+        return m1->disk ? m1 : NULL;
+    } else if (m1->packed) {
+        /* whole 64-bit words per row, and whole cache lines for the buffer */
+        m1->stride = (ysize + 63) & ~(size_t)63;
+        size_t bytes = (xsize * (m1->stride / 8) + CACHE_LINE-1) & ~(size_t)(CACHE_LINE-1);
+        m1->walls = (uint64_t*)aligned_alloc(CACHE_LINE, bytes);
+        countAlloc(bytes);
+    } else if (m1->tiled) {
+        /* whole blocks both ways; each block is one page */
+        m1->tilesAcross = (ysize + TILE_MASK) >> TILE_SHIFT;
+        m1->stride = m1->tilesAcross * TILE_SIDE;
+        m1->arr = (char*)aligned_alloc(TILE_CELLS, numCells(m1));
+        countAlloc(numCells(m1));
+    } else {
+        /* round each row up to a whole number of cache lines so every row starts aligned */
+        m1->stride = (ysize + CACHE_LINE-1) & ~(size_t)(CACHE_LINE-1);
+        m1->arr = (char*)aligned_alloc(CACHE_LINE, xsize * m1->stride);
+        countAlloc(xsize * m1->stride);
+    }
+    if (m1->arr == NULL && m1->walls == NULL) {
+        fprintf(m1->out, "Unable to allocate a %d x %d maze.\n", m1->xsize, m1->ysize);
+        return NULL;
+    }
+    return m1;
+}
+
+void markBorders(maze *m1) {
+    int i;
+    if (m1->sparse) {
+        return;
+    }
+    if (m1->packed || m1->tiled) {
+        for (i=0; i < m1->ysize+2; i++) {
+            setCell(m1, 0, i, '*');
+            setCell(m1, m1->xsize+1, i, '*');
+        }
+    } else {
+        memset(&CELL(m1, 0, 0), '*', m1->ysize+2);
+        memset(&CELL(m1, m1->xsize+1, 0), '*', m1->ysize+2);
+    }
+    for (i=1; i < m1->xsize+1; i++) {
+        setCell(m1, i, 0, '*');
+        setCell(m1, i, m1->ysize+1, '*');
+    }
+}
+
+// sparse maze ===============================================================
+
+static void sparseAdd(sparseGrid *g, uint64_t key, char type) {
+    if (g->count == g->size) {
+        size_t newSize = g->size ? g->size * 2 : STACK_INIT_SIZE;
+        sparseCell *cells = (sparseCell*)realloc(g->cells, sizeof(sparseCell) * newSize);
+        if (cells == NULL) {
+            printf("Unable to grow the obstacle list past %zu entries.\n", g->count);
+            exit(-1);
+        }
+        countAlloc(sizeof(sparseCell) * (newSize - g->size));
+        g->cells = cells;
+        g->size = newSize;
+    }
+    g->cells[g->count].key = key;
+    g->cells[g->count].line = (uint32_t)g->count;
+    g->cells[g->count++].type = type;
+}
+
+static int compareSparse(const void *a, const void *b) {
+    const sparseCell *x = (const sparseCell*)a, *y = (const sparseCell*)b;
+    if (x->key != y->key) {
+        return (x->key > y->key) - (x->key < y->key);
+    }
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+/* order by cell, keeping the last entry given for each */
+void sparseSort(sparseGrid *g) {
+    size_t n = 0;
+
+    qsort(g->cells, g->count, sizeof(sparseCell), compareSparse);
+    for (size_t i = 0; i < g->count; i++) {
+        if (i + 1 < g->count && g->cells[i+1].key == g->cells[i].key) {
+            continue;
+        }
+        g->cells[n++] = g->cells[i];
+    }
+    g->count = n;
+}
+
+/* index of the first entry at or after key */
+static size_t sparseLower(const sparseGrid *g, uint64_t key) {
+    size_t lo = 0, hi = g->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (g->cells[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* '*' for a wall, border included, 'C' for a coin, 0 for an open cell */
+static inline char sparseType(const maze *m1, size_t idx) {
+    size_t x = idx / m1->stride, y = idx % m1->stride;
+    if (x == 0 || y == 0 || x > (size_t)m1->xsize || y > (size_t)m1->ysize) {
+        return '*';
+    }
+    size_t i = sparseLower(&m1->obstacles, idx);
+    return i < m1->obstacles.count && m1->obstacles.cells[i].key == idx ? m1->obstacles.cells[i].type : 0;
+}
+
+// tile cache ================================================================
+
+static inline size_t tileSlotHash(uint64_t tile, size_t mask) {
+    return (size_t)((tile * 0x9E3779B97F4A7C15ULL) >> 17) & mask;
+}
+
+/* A new tile file of numTiles zeroed tiles, and a cache of about bytes
+   over it. The file is prefix plus a unique suffix from mkstemp, so no
+   existing file is touched and mazes solved at once (-B) each get their
+   own. It is unlinked as soon as it is open and goes away with the
+   descriptor. The file is sized up front; its holes read back as zeros. */
+tileCache *tileCacheOpen(const char *prefix, size_t numTiles, size_t bytes) {
+    size_t len = strlen(prefix);
+    char *name = (char*)malloc(len + sizeof(".XXXXXX"));
+    tileCache *tc = (tileCache*)calloc(1, sizeof(tileCache));
+    if (name == NULL || tc == NULL) {
+        free(name);
+        free(tc);
+        return NULL;
+    }
+    memcpy(name, prefix, len);
+    memcpy(name + len, ".XXXXXX", sizeof(".XXXXXX"));
+    tc->fd = mkstemp(name);
+    if (tc->fd >= 0) {
+        unlink(name);
+    }
+    free(name);
+    if (tc->fd < 0 || ftruncate(tc->fd, (off_t)(numTiles * TILE_CELLS)) != 0) {
+        if (tc->fd >= 0) {
+            close(tc->fd);
+        }
+        free(tc);
+        return NULL;
+    }
+
+    tc->slots = bytes / TILE_CELLS;
+    tc->slots = tc->slots < 4 ? 4 : tc->slots > numTiles ? numTiles : tc->slots;
+    size_t tableSize = 1;
+    while (tableSize < 2 * tc->slots) {
+        tableSize *= 2;
+    }
+    tc->tableMask = tableSize - 1;
+    tc->data = (uint8_t*)aligned_alloc(TILE_CELLS, tc->slots * TILE_CELLS);
+    tc->tileOf = (uint64_t*)calloc(tc->slots, sizeof(uint64_t));
+    tc->dirty = (bool*)calloc(tc->slots, sizeof(bool));
+    tc->prev = (uint32_t*)malloc(sizeof(uint32_t) * tc->slots);
+    tc->next = (uint32_t*)malloc(sizeof(uint32_t) * tc->slots);
+    tc->table = (uint32_t*)calloc(tableSize, sizeof(uint32_t));
+    if (tc->data == NULL || tc->tileOf == NULL || tc->dirty == NULL || tc->prev == NULL
+        || tc->next == NULL || tc->table == NULL) {
+        printf("Unable to allocate a cache of %zu tiles.\n", tc->slots);
+        exit(-1);
+    }
+    countAlloc(tc->slots * (TILE_CELLS + sizeof(uint64_t) + sizeof(bool) + 2 * sizeof(uint32_t))
+               + tableSize * sizeof(uint32_t));
+    tc->head = tc->tail = NO_SLOT;
+    return tc;
+}
+
+void tileCacheClose(tileCache *tc) {
+    close(tc->fd);
+    free(tc->data);
+    free(tc->tileOf);
+    free(tc->dirty);
+    free(tc->prev);
+    free(tc->next);
+    free(tc->table);
+    free(tc);
+}
+
+static void tileIO(tileCache *tc, uint32_t slot, bool write) {
+    uint8_t *buf = tc->data + (size_t)slot * TILE_CELLS;
+    off_t at = (off_t)((tc->tileOf[slot] - 1) * TILE_CELLS);
+    ssize_t done = write ? pwrite(tc->fd, buf, TILE_CELLS, at) : pread(tc->fd, buf, TILE_CELLS, at);
+    if (done != TILE_CELLS) {
+        printf("Unable to %s tile %llu of the tile file.\n", write ? "write" : "read",
+               (unsigned long long)(tc->tileOf[slot] - 1));
+        exit(-1);
+    }
+    if (write) {
+        tc->bytesWritten += TILE_CELLS;
+    } else {
+        tc->bytesRead += TILE_CELLS;
+    }
+}
+
+static void lruUnlink(tileCache *tc, uint32_t slot) {
+    if (tc->prev[slot] != NO_SLOT) {
+        tc->next[tc->prev[slot]] = tc->next[slot];
+    } else {
+        tc->head = tc->next[slot];
+    }
+    if (tc->next[slot] != NO_SLOT) {
+        tc->prev[tc->next[slot]] = tc->prev[slot];
+    } else {
+        tc->tail = tc->prev[slot];
+    }
+}
+
+static void lruPushFront(tileCache *tc, uint32_t slot) {
+    tc->prev[slot] = NO_SLOT;
+    tc->next[slot] = tc->head;
+    if (tc->head != NO_SLOT) {
+        tc->prev[tc->head] = slot;
+    } else {
+        tc->tail = slot;
+    }
+    tc->head = slot;
+}
+
+/* drop the table entry for tile, shifting later entries of its probe run back */
+static void tableRemove(tileCache *tc, uint64_t tile) {
+    size_t hole = tileSlotHash(tile, tc->tableMask);
+    while (tc->tileOf[tc->table[hole] - 1] != tile) {
+        hole = (hole + 1) & tc->tableMask;
+    }
+    for (size_t slot = (hole + 1) & tc->tableMask; tc->table[slot] != 0; slot = (slot + 1) & tc->tableMask) {
+        size_t home = tileSlotHash(tc->tileOf[tc->table[slot] - 1], tc->tableMask);
+        if (((slot - home) & tc->tableMask) >= ((slot - hole) & tc->tableMask)) {
+            tc->table[hole] = tc->table[slot];
+            hole = slot;
+        }
+    }
+    tc->table[hole] = 0;
+}
+
+/* the cached bytes of tile, read in if needed, evicting the least recently used */
+static uint8_t *tileAt(tileCache *tc, uint64_t tile, bool write) {
+    uint64_t key = tile + 1;
+    uint32_t slot;
+
+    if (key == tc->lastTile) {
+        tc->hits++;
+        slot = tc->lastSlot;
+    } else {
+        size_t h = tileSlotHash(key, tc->tableMask);
+        while (tc->table[h] != 0 && tc->tileOf[tc->table[h] - 1] != key) {
+            h = (h + 1) & tc->tableMask;
+        }
+        if (tc->table[h] != 0) {
+            tc->hits++;
+            slot = tc->table[h] - 1;
+            if (slot != tc->head) {
+                lruUnlink(tc, slot);
+                lruPushFront(tc, slot);
+            }
+        } else {
+            tc->misses++;
+            if (tc->used < tc->slots) {
+                slot = (uint32_t)tc->used++;
+            } else {
+                slot = tc->tail;
+                if (tc->dirty[slot]) {
+                    tileIO(tc, slot, true);
+                    tc->dirty[slot] = false;
+                }
+                tableRemove(tc, tc->tileOf[slot]);
+                lruUnlink(tc, slot);
+                h = tileSlotHash(key, tc->tableMask);
+                while (tc->table[h] != 0) {
+                    h = (h + 1) & tc->tableMask;
+                }
+            }
+            tc->tileOf[slot] = key;
+            tc->table[h] = slot + 1;
+            tileIO(tc, slot, false);
+            lruPushFront(tc, slot);
+        }
+        tc->lastTile = key;
+        tc->lastSlot = slot;
+    }
+    tc->dirty[slot] |= write;
+    return tc->data + (size_t)slot * TILE_CELLS;
+}
+
+static inline uint8_t *diskCell(const maze *m1, size_t idx, bool write) {
+    return tileAt(m1->disk, idx / TILE_CELLS, write) + idx % TILE_CELLS;
+}
+
+// packed maze ===============================================================
+
+static inline size_t coinSlot(size_t idx, size_t mask) {
+    return (size_t)(((uint64_t)idx * 0x9E3779B97F4A7C15ULL) >> 17) & mask;
+}
+
+static void coinRehash(coinSet *set, size_t newCap) {
+    uint64_t *old = set->keys;
+    size_t oldCap = old ? set->mask + 1 : 0;
+
+    set->keys = (uint64_t*)calloc(newCap, sizeof(uint64_t));
+    countAlloc(sizeof(uint64_t) * newCap);
+    if (set->keys == NULL) {
+        printf("Unable to grow the coin set past %zu entries.\n", set->count);
+        exit(-1);
+    }
+    set->mask = newCap - 1;
+    for (size_t i = 0; i < oldCap; i++) {
+        if (old[i] != 0) {
+            size_t slot = coinSlot((size_t)old[i] - 1, set->mask);
+            while (set->keys[slot] != 0) {
+                slot = (slot + 1) & set->mask;
+            }
+            set->keys[slot] = old[i];
+        }
+    }
+    free(old);
+}
+
+/* returns false if the coin was already there */
+bool coinAdd(coinSet *set, size_t idx) {
+    if (set->keys == NULL || (set->count + 1) * 2 > set->mask + 1) {
+        coinRehash(set, set->keys ? (set->mask + 1) * 2 : 64);
+    }
+    size_t slot = coinSlot(idx, set->mask);
+    while (set->keys[slot] != 0) {
+        if (set->keys[slot] == (uint64_t)idx + 1) {
+            return false;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+    set->keys[slot] = (uint64_t)idx + 1;
+    set->count++;
+    return true;
+}
+
+bool coinHas(const coinSet *set, size_t idx) {
+    if (set->count == 0) {
+        return false;
+    }
+    size_t slot = coinSlot(idx, set->mask);
+    while (set->keys[slot] != 0) {
+        if (set->keys[slot] == (uint64_t)idx + 1) {
+            return true;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+    return false;
+}
+
+/* linear-probing delete: shift later members of the cluster back instead of leaving tombstones */
+void coinRemove(coinSet *set, size_t idx) {
+    if (set->count == 0) {
+        return;
+    }
+    size_t slot = coinSlot(idx, set->mask);
+    while (set->keys[slot] != (uint64_t)idx + 1) {
+        if (set->keys[slot] == 0) {
+            return;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+    size_t hole = slot;
+    for (;;) {
+        slot = (slot + 1) & set->mask;
+        if (set->keys[slot] == 0) {
+            break;
+        }
+        size_t home = coinSlot((size_t)set->keys[slot] - 1, set->mask);
+        /* move it into the hole unless its home lies cyclically in (hole, slot] */
+        if (((slot - home) & set->mask) >= ((slot - hole) & set->mask)) {
+            set->keys[hole] = set->keys[slot];
+            hole = slot;
+        }
+    }
+    set->keys[hole] = 0;
+    set->count--;
+}
+
+void coinFree(coinSet *set) {
+    free(set->keys);
+    memset(set, 0, sizeof(*set));
+}
+
+static int compareIndex(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static inline bool wallBit(const maze *m1, size_t idx) {
+    return (m1->walls[idx / 64] >> (idx % 64)) & 1;
+}
+
+static inline bool isWall(const maze *m1, size_t idx) {
+    if (m1->sparse) {
+        return sparseType(m1, idx) == '*';
+    }
+    if (m1->disk) {
+        return (*diskCell(m1, idx, false) & DISK_TYPE) == DISK_WALL;
+    }
+    return m1->arr ? m1->arr[idx] == '*' : wallBit(m1, idx);
+}
+
+static inline bool hasCoin(const maze *m1, size_t idx) {
+    if (m1->sparse) {
+        return sparseType(m1, idx) == 'C';
+    }
+    if (m1->disk) {
+        return (*diskCell(m1, idx, false) & DISK_TYPE) == DISK_COIN;
+    }
+    return m1->arr ? m1->arr[idx] == 'C' : coinHas(&m1->coins, idx);
+}
+
+/* the character a cell renders as, for either representation */
+char cellChar(const maze *m1, int x, int y) {
+    size_t idx = cellIndex(m1, x, y);
+    if (m1->arr) {
+        return m1->arr[idx];
+    }
+    if (isWall(m1, idx)) {
+        return '*';
+    } else if (x == m1->xstart && y == m1->ystart) {
+        return 's';
+    } else if (x == m1->xend && y == m1->yend) {
+        return 'e';
+    }
+    return hasCoin(m1, idx) ? 'C' : '.';
+}
+
+/* store a cell; a packed maze keeps only walls and coins, start and end are implicit */
+void setCell(maze *m1, int x, int y, char c) {
+    size_t idx = cellIndex(m1, x, y);
+    if (m1->arr) {
+        m1->arr[idx] = c;
+        return;
+    }
+    if (m1->sparse) {
+        if (c == '*' || c == 'C') {
+            sparseAdd(&m1->obstacles, idx, c);
+        }
+        return;
+    }
+    if (m1->disk) {
+        *diskCell(m1, idx, true) = c == '*' ? DISK_WALL : c == 'C' ? DISK_COIN : 0;
+        return;
+    }
+    if (c == '*') {
+        m1->walls[idx / 64] |= 1ULL << (idx % 64);
+        coinRemove(&m1->coins, idx);
+    } else {
+        m1->walls[idx / 64] &= ~(1ULL << (idx % 64));
+        if (c == 'C') {
+            coinAdd(&m1->coins, idx);
+        } else {
+            coinRemove(&m1->coins, idx);
+        }
+    }
+}
+
+/* words per row of a wall bitmap, as packed mazes and wallBitmap lay them out */
+static inline size_t rowWords(const maze *m1) {
+    return ((size_t)m1->ysize + 2 + 63) / 64;
+}
+
+/* The walls as bits, in rows of rowWords words: a packed maze's own
+   bitmap, or one built from a char maze into *built for the caller to free;
+   NULL if that can't be allocated. */
+static const uint64_t *wallBitmap(const maze *m1, uint64_t **built) {
+    size_t rows = (size_t)m1->xsize + 2;
+    size_t words = rowWords(m1);
+
+    *built = NULL;
+    if (m1->arr == NULL) {
+        return m1->walls;
+    }
+    *built = (uint64_t*)calloc(rows * words, sizeof(uint64_t));
+    if (*built == NULL) {
+        return NULL;
+    }
+    countAlloc(sizeof(uint64_t) * rows * words);
+    for (size_t x = 0; x < rows; x++) {
+        for (size_t y = 0; y < (size_t)m1->ysize + 2; y++) {
+            (*built)[x * words + y / 64] |= (uint64_t)(CELL(m1, (int)x, (int)y) == '*') << (y % 64);
+        }
+    }
+    return *built;
+}
+
+/* Open neighbours of (x, y) as a mask of moveDir bits. A packed maze reads
+   the current row's word once for both horizontal neighbours, and one word
+   each from the rows above and below. */
+static inline unsigned openDirs(const maze *m1, int x, int y) {
+    if (m1->sparse || m1->disk) {
+        size_t idx = cellIndex(m1, x, y);
+        return (unsigned)!isWall(m1, stepCell(m1, idx, MOVE_DOWN))
+             | (unsigned)!isWall(m1, stepCell(m1, idx, MOVE_RIGHT)) << MOVE_RIGHT
+             | (unsigned)!isWall(m1, stepCell(m1, idx, MOVE_UP)) << MOVE_UP
+             | (unsigned)!isWall(m1, stepCell(m1, idx, MOVE_LEFT)) << MOVE_LEFT;
+    }
+    if (m1->arr) {
+        size_t idx = cellIndex(m1, x, y);
+        return (unsigned)(m1->arr[stepCell(m1, idx, MOVE_DOWN)] != '*')
+             | (unsigned)(m1->arr[stepCell(m1, idx, MOVE_RIGHT)] != '*') << MOVE_RIGHT
+             | (unsigned)(m1->arr[stepCell(m1, idx, MOVE_UP)] != '*') << MOVE_UP
+             | (unsigned)(m1->arr[stepCell(m1, idx, MOVE_LEFT)] != '*') << MOVE_LEFT;
+    }
+
+    size_t words = m1->stride / 64;
+    const uint64_t *row = m1->walls + (size_t)x * words + ((unsigned)y >> 6);
+    unsigned b = (unsigned)y & 63;
+    uint64_t near;
+    if (b != 0 && b != 63) {
+        near = row[0] >> (b - 1);
+    } else if (b == 0) {
+        near = (row[-1] >> 63) | (row[0] << 1);
+    } else {
+        near = (row[0] >> 62) | (row[1] << 2);
+    }
+    uint64_t blocked = ((row[words] >> b) & 1)
+                     | ((near >> 2) & 1) << MOVE_RIGHT
+                     | ((row[-(ptrdiff_t)words] >> b) & 1) << MOVE_UP
+                     | (near & 1) << MOVE_LEFT;
+    return (unsigned)(~blocked & 0xF);
+}
+
+/* Expand row x of a packed maze into glyphs, 8 cells per multiply:
+   spread each wall bit into its own byte and turn '.' into '*' where set.
+   coinCursor walks a sorted coin list alongside the rows. */
+static void expandRow(maze *m1, int x, char *out, const uint64_t *coins, size_t numCoins, size_t *coinCursor) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint8_t *bits = (const uint8_t*)(m1->walls + (size_t)x * (m1->stride / 64));
+    size_t width = (size_t)m1->ysize+2;
+
+    for (size_t j = 0; j < width; j += 8) {
+        uint64_t spread = ((uint64_t)bits[j / 8] * ones) & 0x8040201008040201ULL;
+        spread = ((spread + 0x7F * ones) >> 7) & ones;
+        uint64_t glyphs = ('.' * ones) - spread * ('.' - '*');
+        memcpy(out + j, &glyphs, width - j < 8 ? width - j : 8);
+    }
+
+    size_t rowEnd = cellIndex(m1, x+1, 0);
+    while (*coinCursor < numCoins && coins[*coinCursor] < rowEnd) {
+        size_t idx = coins[(*coinCursor)++];
+        if (!wallBit(m1, idx)) {
+            out[idx - cellIndex(m1, x, 0)] = 'C';
+        }
+    }
+    if (x == m1->xstart && !wallBit(m1, cellIndex(m1, x, m1->ystart))) {
+        out[m1->ystart] = 's';
+    }
+    if (x == m1->xend && !wallBit(m1, cellIndex(m1, x, m1->yend))) {
+        out[m1->yend] = 'e';
+    }
+}
+
+/* returns false, with nothing left allocated, if the header describes an unusable maze */
+bool allocateMaze(maze *m1) {
+    /* the first 3 lines of the file were read by checkFile */
+    if (m1->xsize < 1 || m1->ysize < 1) {
+        fprintf(m1->out, "Maze sizes must be greater than 0.\n");
+        return false;
+    }
+    if (m1->xsize > MAZE_MAX_SIDE || m1->ysize > MAZE_MAX_SIDE) {
+        fprintf(m1->out, "Maze sizes must be at most %d.\n", MAZE_MAX_SIDE);
+        return false;
+    }
+    fprintf (m1->out, "size: %d, %d\n", m1->xsize, m1->ysize);
+
+    if (initDynMaze(m1) == NULL) {
+        return false;
+    }
+
+    if (m1->xstart < 1 || m1->xstart > m1->xsize || m1->ystart < 1 || m1->ystart > m1->ysize) {
+        fprintf(m1->out, "Start/End position outside of maze range\n");
+        freeGrid(m1);
+        return false;
+    }
+    fprintf (m1->out, "start: %d, %d\n", m1->xstart, m1->ystart);
+
+    if (m1->xend < 1 || m1->xend > m1->xsize || m1->yend < 1 || m1->yend > m1->ysize) {
+        fprintf(m1->out, "Start/End position outside of maze range\n");
+        freeGrid(m1);
+        return false;
+    }
+    fprintf (m1->out, "end: %d, %d\n", m1->xend, m1->yend);
+
+    return true;
+}
+
+bool prepMaze(maze *m1) {
+    if (!allocateMaze(m1)) {
+        return false;
+    }
+
+    /* initialize the maze to empty; a sparse maze is empty and bordered
+       already, and a new tile file reads back as zeros, which are open cells */
+    if (m1->sparse) {
+        return true;
+    } else if (m1->packed) {
+        memset(m1->walls, 0, numCells(m1) / 8);
+    } else if (m1->arr) {
+        memset(m1->arr, '.', numCells(m1));
+    }
+
+    markBorders(m1);
+    return true;
+}
+
+int errorCheck(maze *m1, long xpos, long ypos) {
+    if (xpos == m1->xstart && ypos == m1->ystart) {
+        return LINE_BLOCKS_ENDPOINT;
+    } else if (xpos == m1->xend && ypos == m1->yend) {
+        return LINE_BLOCKS_ENDPOINT;
+    } else if (xpos > m1->xsize || xpos < 1 || ypos > m1->ysize || ypos < 1) {
+        return LINE_OUT_OF_RANGE;
+    }
+
+    return LINE_OK;
+}
+
+static const char* lineErrorMsg[NUM_LINE_ERRORS] = {
+    [LINE_BLOCKS_ENDPOINT] = "Invalid coordinates: attempting to block start/end position.",
+    [LINE_OUT_OF_RANGE] = "Invalid coordinates: outside of maze range.",
+    [LINE_BAD_TYPE] = "Invalid type: type is not recognized.",
+    [LINE_MALFORMED] = "Invalid line: expected <x> <y> <type>.",
+};
+
+static void reportLineErrors(maze *m1, const size_t *errors) {
+    for (int i = LINE_OK+1; i < NUM_LINE_ERRORS; i++) {
+        if (errors[i] > 0) {
+            fprintf(m1->out, "%s (%zu %s)\n", lineErrorMsg[i], errors[i], errors[i] == 1 ? "line" : "lines");
+        }
+    }
+}
+
+/* returns the number of obstacle lines read */
+size_t fillMaze(mazeSource *src, maze *m1) {
+    size_t errors[NUM_LINE_ERRORS] = {0};
+    size_t lines = 0;
+    const char* p = src->pos;
+    const char* end = src->end;
+    long xpos, ypos;
+    char c;
+
+    /* mark the starting and ending positions in the maze */
+    setCell(m1, m1->xstart, m1->ystart, 's');
+    setCell(m1, m1->xend, m1->yend, 'e');
+
+    while (p < end) {
+        const char* line = skipBlanks(p, end);
+        if (line == end || *line == '\n') {
+            p = line + (line < end);
+            continue;
+        }
+        p = line;
+        lines++;
+        if (!scanInt(&p, end, &xpos) || !scanInt(&p, end, &ypos)) {
+            errors[LINE_MALFORMED]++;
+            p = nextLine(line, end);
+            continue;
+        }
+        p = skipBlanks(p, end);
+        c = (p < end) ? *p : '\n';
+        p = nextLine(p, end);
+
+        int err = errorCheck(m1, xpos, ypos);
+        bool dontAdd = (err != LINE_OK);
+        errors[err]++;
+
+        switch (c) {
+            case 'c' :
+                c = 'C';
+                break;
+            case 'b' :
+                c = '*';
+                break;
+            default :
+                errors[LINE_BAD_TYPE]++;
+                dontAdd = true;
+        }
+
+        if (!dontAdd) {
+            setCell(m1, (int)xpos, (int)ypos, c);
+        }
+    }
+    src->pos = p;
+    if (m1->sparse) {
+        sparseSort(&m1->obstacles);
+    }
+
+    reportLineErrors(m1, errors);
+    return lines;
+}
+
+void outputMaze(maze *m1) {
+    outBuf ob;
+    obInit(&ob, m1->out);
+
+    /* print out the initial maze */
+    renderMaze(m1, NULL, &ob);
+    obFlush(&ob);
+}
+
+/* Render the grid a row at a time into ob. When overlay is given, cells on
+   that path are drawn as '+', leaving start, end and coins visible. */
+void renderMaze(maze *m1, stack *overlay, outBuf *ob) {
+    size_t width = (size_t)m1->ysize+2;
+    uint64_t *onPath = NULL;
+    uint64_t *coins = NULL;
+    size_t numCoins = 0, coinCursor = 0;
+
+    if ((m1->sparse || m1->disk) && numCells(m1) > SPARSE_DRAW_MAX) {
+        char note[96];
+        int n = m1->sparse
+              ? snprintf(note, sizeof(note), "(%zu obstacles on %d x %d cells, too large to draw)\n",
+                         m1->obstacles.count, m1->xsize, m1->ysize)
+              : snprintf(note, sizeof(note), "(%zu tiles on disk for %d x %d cells, too large to draw)\n",
+                         numCells(m1) / TILE_CELLS, m1->xsize, m1->ysize);
+        obWrite(ob, note, (size_t)n);
+        return;
+    }
+    char *rowBuf = (char*)malloc(width + 8);
+
+    /* a packed maze is drawn row by row from the bits, with its coins in index order */
+    if (rowBuf != NULL && m1->walls != NULL && m1->coins.count > 0) {
+        coins = (uint64_t*)malloc(sizeof(uint64_t) * m1->coins.count);
+    }
+    if (rowBuf == NULL || (m1->walls != NULL && m1->coins.count > 0 && coins == NULL)) {
+        obWrite(ob, "(unable to allocate the render buffer)\n", 39);
+        free(rowBuf);
+        return;
+    }
+    if (coins != NULL) {
+        for (size_t i = 0; i <= m1->coins.mask; i++) {
+            if (m1->coins.keys[i] != 0) {
+                coins[numCoins++] = m1->coins.keys[i] - 1;
+            }
+        }
+        qsort(coins, numCoins, sizeof(uint64_t), compareIndex);
+    }
+
+    if (overlay != NULL && overlay->numItems > 0) {
+        size_t cells = numCells(m1);
+        onPath = (uint64_t*)calloc((cells + 63) / 64, sizeof(uint64_t));
+        pathCursor c;
+        for (pathBegin(&c, overlay); c.at < overlay->numItems; pathNext(&c)) {
+            size_t idx = cellIndex(m1, c.cell.xpos, c.cell.ypos);
+            onPath[idx / 64] |= 1ULL << (idx % 64);
+        }
+    }
+
+    for (int i = 0; i < m1->xsize+2; i++) {
+        const char *row;
+        if (m1->tiled && m1->arr) {
+            for (size_t j = 0; j < width; j++) {
+                rowBuf[j] = CELL(m1, i, (int)j);
+            }
+            row = rowBuf;
+        } else if (m1->sparse || m1->disk) {
+            for (size_t j = 0; j < width; j++) {
+                rowBuf[j] = cellChar(m1, i, (int)j);
+            }
+            row = rowBuf;
+        } else if (m1->arr) {
+            row = &CELL(m1, i, 0);
+        } else {
+            expandRow(m1, i, rowBuf, coins, numCoins, &coinCursor);
+            row = rowBuf;
+        }
+        if (onPath != NULL) {
+            if (row != rowBuf) {
+                memcpy(rowBuf, row, width);
+            }
+            for (size_t j = 0; j < width; j++) {
+                size_t idx = cellIndex(m1, i, (int)j);
+                if (rowBuf[j] == '.' && (onPath[idx / 64] >> (idx % 64) & 1)) {
+                    rowBuf[j] = '+';
+                }
+            }
+            row = rowBuf;
+        }
+        obWrite(ob, row, width);
+        obPutc(ob, '\n');
+    }
+
+    free(coins);
+    free(rowBuf);
+    free(onPath);
+}
+
+bool createMaze(mazeSource *src, maze *m1) {
+    double t0 = phaseStart(m1);
+    if (!prepMaze(m1)) {
+        return false;
+    }
+    phaseEnd(m1, PHASE_HEADER, t0);
+
+    t0 = phaseStart(m1);
+    size_t lines = fillMaze(src, m1);
+    phaseEnd(m1, PHASE_FILL, t0);
+    if (m1->stats != NULL) {
+        m1->stats->obstacles = lines;
+    }
+    return true;
+}
+
+// related to finding exit to maze ============================================
+
+void searchInit(searchState *ss) {
+    memset(ss, 0, sizeof(*ss));
+}
+
+/* A solver that runs out of memory says so on m1->out and returns this
+   instead of killing the process, so one maze can't end a whole batch. */
+static int outOfMemory(const maze *m1, const char *what) {
+    fprintf(m1->out, "Unable to allocate %s.\n", what);
+    return -1;
+}
+
+/* words in each of a packed search's visited bitmaps */
+static inline size_t seenWords(const searchState *ss) {
+    return (ss->cells + 63) / 64;
+}
+
+/* Start a new solve of m1 from the given number of sides: grow the scratch
+   arrays if this maze is bigger than any before (or needs the other kind of
+   visit marks), then move to a fresh epoch or clear the bitmaps. */
+static bool searchBeginSides(searchState *ss, const maze *m1, int sides) {
+    size_t cells = numCells(m1);
+    bool bits = m1->packed;
+
+    if (cells > ss->cells || bits != (ss->seen != NULL) || (bits && sides > ss->sides)) {
+        searchFree(ss);
+        size_t words = (cells + 63) / 64;
+        if (bits) {
+            ss->seen = (uint64_t*)malloc(sizeof(uint64_t) * words * (size_t)sides);
+            countAlloc(sizeof(uint64_t) * words * (size_t)sides);
+        } else {
+            ss->stamp = (uint16_t*)calloc(cells, sizeof(uint16_t));
+            countAlloc(sizeof(uint16_t) * cells);
+        }
+        ss->parent = (uint8_t*)malloc((cells + 3) / 4);
+        countAlloc((cells + 3) / 4);
+        if ((ss->seen == NULL && ss->stamp == NULL) || ss->parent == NULL) {
+            searchFree(ss);
+            return false;
+        }
+        ss->cells = cells;
+        ss->sides = sides;
+    }
+    if (bits) {
+        for (int side = 0; side < sides; side++) {
+            memset(ss->seen + (size_t)side * seenWords(ss), 0, sizeof(uint64_t) * ((cells + 63) / 64));
+        }
+    } else if (++ss->epoch == 0) {
+        memset(ss->stamp, 0, sizeof(uint16_t) * ss->cells);
+        ss->epoch = 1;
+    }
+    return true;
+}
+
+bool searchBegin(searchState *ss, const maze *m1) {
+    return searchBeginSides(ss, m1, 1);
+}
+
+void searchFree(searchState *ss) {
+    free(ss->stamp);
+    free(ss->seen);
+    free(ss->parent);
+    searchInit(ss);
+}
+
+static inline bool isVisited(const searchState *ss, size_t idx) {
+    if (ss->seen != NULL) {
+        return ss->seen[idx >> 6] >> (idx & 63) & 1;
+    }
+    return ss->stamp[idx] == ss->epoch;
+}
+
+static inline void markVisited(searchState *ss, size_t idx) {
+    if (ss->seen != NULL) {
+        ss->seen[idx >> 6] |= (uint64_t)1 << (idx & 63);
+    } else {
+        ss->stamp[idx] = ss->epoch;
+    }
+}
+
+/* open neighbours of (x, y) the search has not been to yet */
+static inline unsigned unvisitedDirs(const maze *m1, const searchState *ss, int x, int y) {
+    size_t idx = cellIndex(m1, x, y);
+    return openDirs(m1, x, y)
+         & ~((unsigned)isVisited(ss, stepCell(m1, idx, MOVE_DOWN))
+           | (unsigned)isVisited(ss, stepCell(m1, idx, MOVE_RIGHT)) << MOVE_RIGHT
+           | (unsigned)isVisited(ss, stepCell(m1, idx, MOVE_UP)) << MOVE_UP
+           | (unsigned)isVisited(ss, stepCell(m1, idx, MOVE_LEFT)) << MOVE_LEFT);
+}
+
+/* one step of the depth-first walk; false if the path could not grow */
+bool attemptMove(const maze *m1, stack* path, searchState *ss, bool debugMode) {
+    int xCurr = top(path)->xpos;
+    int yCurr = top(path)->ypos;
+    unsigned open = unvisitedDirs(m1, ss, xCurr, yCurr);
+
+    /* lowest set bit is the first of +x, +y, -x, -y that is open */
+    if (open != 0) {
+        int dir = __builtin_ctz(open);
+        xCurr += dirDx[dir];
+        yCurr += dirDy[dir];
+        if (push(path, xCurr, yCurr, debugMode) == NULL) {
+            return false;
+        }
+
+    } else {
+        if (hasCoin(m1, cellIndex(m1, top(path)->xpos, top(path)->ypos))) {
+            path->numCoins--;
+            path->coinsDropped++;
+            if (debugMode) {
+                traceRecord(TRACE_COIN_DROP, top(path)->xpos, top(path)->ypos);
+            }
+        }
+        pop(path, debugMode);
+    }
+
+    size_t idx = cellIndex(m1, xCurr, yCurr);
+    if (!isVisited(ss, idx)) {
+        if (hasCoin(m1, idx)) {
+            path->numCoins += 1;
+            if (debugMode) {
+                traceRecord(TRACE_COIN, xCurr, yCurr);
+            }
+        }
+        path->expanded++;
+        markVisited(ss, idx);
+    }
+    return true;
+}
+
+/* Depth-first walk; the start cell is only marked once the walk steps back onto it. */
+int findPath(const maze *m1, stack *path, searchState *ss, bool debugMode) {
+    if (!searchBegin(ss, m1)) {
+        return outOfMemory(m1, "the search state");
+    }
+    if (push(path, m1->xstart, m1->ystart, debugMode) == NULL) {
+        return outOfMemory(m1, "the path stack");
+    }
+    path->expanded++;
+    while (top(path)->xpos != m1->xend || top(path)->ypos != m1->yend) {
+        if (!attemptMove(m1, path, ss, debugMode)) {
+            return outOfMemory(m1, "the path stack");
+        }
+        if (is_empty(path)) {
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+// breadth-first solver ======================================================
+
+/* flat FIFO of cell indices; grows (and unwraps) only if a frontier outgrows it */
+typedef struct cellQueue {
+    size_t* items;
+    size_t head, count, mask;
+    bool failed;        /* a push found the queue full and could not grow it */
+} cellQueue;
+
+static bool queueInit(cellQueue *q, size_t capacity) {
+    size_t cap = 64;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+    q->items = (size_t*)malloc(sizeof(size_t)*cap);
+    countAlloc(sizeof(size_t)*cap);
+    q->head = q->count = 0;
+    q->mask = cap - 1;
+    q->failed = false;
+    return q->items != NULL;
+}
+
+/* false, with idx dropped, if the queue is full and can't grow */
+static bool queuePush(cellQueue *q, size_t idx) {
+    if (q->count > q->mask) {
+        size_t cap = q->mask + 1;
+        size_t* items = (size_t*)malloc(sizeof(size_t)*cap*2);
+        countAlloc(sizeof(size_t)*cap*2);
+        if (items == NULL) {
+            q->failed = true;
+            return false;
+        }
+        for (size_t n = 0; n < q->count; n++) {
+            items[n] = q->items[(q->head + n) & q->mask];
+        }
+        free(q->items);
+        q->items = items;
+        q->head = 0;
+        q->mask = cap*2 - 1;
+    }
+    q->items[(q->head + q->count++) & q->mask] = idx;
+    return true;
+}
+
+static inline size_t queuePop(cellQueue *q) {
+    size_t idx = q->items[q->head];
+    q->head = (q->head + 1) & q->mask;
+    q->count--;
+    return idx;
+}
+
+static inline int getParentDir(const uint8_t *parent, size_t idx) {
+    return (parent[idx >> 2] >> ((idx & 3) * 2)) & 3;
+}
+
+static inline void setParentDir(uint8_t *parent, size_t idx, int dir) {
+    unsigned shift = (idx & 3) * 2;
+    parent[idx >> 2] = (uint8_t)((parent[idx >> 2] & ~(3u << shift)) | (unsigned)dir << shift);
+}
+
+/* Extend path from start to end by following parent directions back from
+   the end. The first walk counts the steps and the coins on the way; the
+   second writes the moves into place from the last one back. An empty
+   path gets the start cell first, otherwise it must already end there.
+   Returns false if the path could not grow. */
+static bool buildPath(const maze *m1, const uint8_t *parent, stack *path) {
+    size_t steps = 0;
+    int x = m1->xend, y = m1->yend;
+
+    while (x != m1->xstart || y != m1->ystart) {
+        steps++;
+        if (hasCoin(m1, cellIndex(m1, x, y))) {
+            path->numCoins++;
+        }
+        int dir = getParentDir(parent, cellIndex(m1, x, y));
+        x -= dirDx[dir];
+        y -= dirDy[dir];
+    }
+    if (is_empty(path) && push(path, x, y, false) == NULL) {
+        return false;
+    }
+    size_t base = path->numItems - 1;
+    if (!reserveSteps(path, base + steps)) {
+        return false;
+    }
+
+    x = m1->xend;
+    y = m1->yend;
+    for (size_t k = steps; k > 0; k--) {
+        int dir = getParentDir(parent, cellIndex(m1, x, y));
+        setStepDir(path, base + k - 1, dir);
+        x -= dirDx[dir];
+        y -= dirDy[dir];
+    }
+    path->numItems += steps;
+    path->last.xpos = m1->xend;
+    path->last.ypos = m1->yend;
+    if (path->numItems > path->maxDepth) {
+        path->maxDepth = path->numItems;
+    }
+    return true;
+}
+
+/* Breadth-first search from start; the first time the end is reached the
+   path is a shortest one. */
+int findPathBFS(const maze *m1, stack *path, searchState *ss) {
+    size_t startIdx = cellIndex(m1, m1->xstart, m1->ystart);
+    size_t endIdx = cellIndex(m1, m1->xend, m1->yend);
+    cellQueue q;
+    int found = 0;
+
+    if (!searchBegin(ss, m1)) {
+        return outOfMemory(m1, "the search state");
+    }
+    if (!queueInit(&q, 2 * ((size_t)m1->xsize + m1->ysize + 4))) {
+        return outOfMemory(m1, "the search queue");
+    }
+    markVisited(ss, startIdx);
+    queuePush(&q, startIdx);
+
+    while (q.count > 0 && !q.failed) {
+        size_t idx = queuePop(&q);
+        path->expanded++;
+        if (idx == endIdx) {
+            found = 1;
+            break;
+        }
+        unsigned open = openDirs(m1, cellRow(m1, idx), cellCol(m1, idx));
+        for (int dir = 0; dir < 4; dir++) {
+            size_t next = stepCell(m1, idx, dir);
+            if (!(open >> dir & 1) || isVisited(ss, next)) {
+                continue;
+            }
+            markVisited(ss, next);
+            setParentDir(ss->parent, next, dir);
+            if (!queuePush(&q, next)) {
+                break;
+            }
+        }
+    }
+
+    free(q.items);
+    if (q.failed) {
+        return outOfMemory(m1, "the search queue");
+    }
+    if (found && !buildPath(m1, ss->parent, path)) {
+        return outOfMemory(m1, "the path stack");
+    }
+    return found;
+}
+
+/* Two fresh epochs, for a search from both ends: cells reached from the
+   start are stamped epoch-1 and cells reached from the end epoch. If the
+   pair would straddle the wrap, the wrap is taken first. A packed maze
+   gets a cleared bitmap per end instead. */
+static bool searchBeginBoth(searchState *ss, const maze *m1) {
+    if (m1->packed) {
+        return searchBeginSides(ss, m1, 2);
+    }
+    if (!searchBegin(ss, m1)) {
+        return false;
+    }
+    if (ss->epoch == UINT16_MAX && !searchBegin(ss, m1)) {
+        return false;
+    }
+    return searchBegin(ss, m1);
+}
+
+/* whether the search from one end (0 the start, 1 the end) has reached idx */
+static inline bool sideVisited(const searchState *ss, int side, size_t idx) {
+    if (ss->seen != NULL) {
+        return ss->seen[(size_t)side * seenWords(ss) + (idx >> 6)] >> (idx & 63) & 1;
+    }
+    return ss->stamp[idx] == (uint16_t)(ss->epoch - 1 + side);
+}
+
+static inline void markSide(searchState *ss, int side, size_t idx) {
+    if (ss->seen != NULL) {
+        ss->seen[(size_t)side * seenWords(ss) + (idx >> 6)] |= (uint64_t)1 << (idx & 63);
+    } else {
+        ss->stamp[idx] = (uint16_t)(ss->epoch - 1 + side);
+    }
+}
+
+/* Breadth-first search from start and end at once, a whole level at a time
+   from whichever side has the smaller frontier. Each side keeps its own
+   parent directions in the shared array; the first edge found between the
+   two sides joins a shortest path. Walking the end's side back gives the
+   second half in order. */
+int findPathBidirectional(const maze *m1, stack *path, searchState *ss, bool debugMode) {
+    size_t startIdx = cellIndex(m1, m1->xstart, m1->ystart);
+    size_t endIdx = cellIndex(m1, m1->xend, m1->yend);
+    cellQueue q[2];
+    size_t meetFrom = 0;
+    int meetDir = 0;
+    bool met = (startIdx == endIdx);
+
+    if (!searchBeginBoth(ss, m1)) {
+        return outOfMemory(m1, "the search state");
+    }
+    bool queued = queueInit(&q[0], (size_t)m1->xsize + m1->ysize + 4);
+    queued = queueInit(&q[1], (size_t)m1->xsize + m1->ysize + 4) && queued;
+    if (!queued) {
+        free(q[0].items);
+        free(q[1].items);
+        return outOfMemory(m1, "the search queue");
+    }
+    markSide(ss, 0, startIdx);
+    queuePush(&q[0], startIdx);
+    markSide(ss, 1, endIdx);
+    queuePush(&q[1], endIdx);
+
+    while (!met && q[0].count > 0 && q[1].count > 0 && !q[0].failed && !q[1].failed) {
+        int side = q[1].count < q[0].count;
+        for (size_t n = q[side].count; n > 0 && !met && !q[side].failed; n--) {
+            size_t idx = queuePop(&q[side]);
+            path->expanded++;
+            path->expandedEnd += (size_t)side;
+            unsigned open = openDirs(m1, cellRow(m1, idx), cellCol(m1, idx));
+            for (int dir = 0; dir < 4; dir++) {
+                size_t next = stepCell(m1, idx, dir);
+                if (!(open >> dir & 1) || sideVisited(ss, side, next)) {
+                    continue;
+                }
+                if (sideVisited(ss, !side, next)) {
+                    /* the join as a move from the start's side to the end's */
+                    meetFrom = side == 0 ? idx : next;
+                    meetDir = side == 0 ? dir : (dir + 2) & 3;
+                    met = true;
+                    break;
+                }
+                markSide(ss, side, next);
+                setParentDir(ss->parent, next, dir);
+                if (!queuePush(&q[side], next)) {
+                    break;
+                }
+            }
+        }
+    }
+
+    bool grown = true;
+    free(q[0].items);
+    free(q[1].items);
+    if (q[0].failed || q[1].failed) {
+        return outOfMemory(m1, "the search queue");
+    }
+    if (met && startIdx == endIdx) {
+        grown = push(path, m1->xstart, m1->ystart, debugMode) != NULL;
+    } else if (met) {
+        /* the start's half as BFS builds it, then the join and the end's half */
+        maze half = *m1;
+        half.xend = cellRow(m1, meetFrom);
+        half.yend = cellCol(m1, meetFrom);
+        grown = buildPath(&half, ss->parent, path);
+
+        int x = half.xend + dirDx[meetDir], y = half.yend + dirDy[meetDir];
+        while (grown) {
+            if (push(path, x, y, debugMode) == NULL) {
+                grown = false;
+                break;
+            }
+            if (hasCoin(m1, cellIndex(m1, x, y))) {
+                path->numCoins++;
+            }
+            if (x == m1->xend && y == m1->yend) {
+                break;
+            }
+            int dir = getParentDir(ss->parent, cellIndex(m1, x, y));
+            x -= dirDx[dir];
+            y -= dirDy[dir];
+        }
+    }
+
+    if (!grown) {
+        return outOfMemory(m1, "the path stack");
+    }
+    return met;
+}
+
+// A* solver =================================================================
+
+/* Bucket queue keyed on f = g + h. With unit steps and the Manhattan
+   heuristic a move changes f by 0 or 2, so only the buckets for the
+   current f and f+2 are ever live and a ring of 4 covers them. Entries
+   pack the cell index with the direction that reached it. */
+#define NUM_BUCKETS 4
+
+typedef struct bucket {
+    uint64_t* items;
+    size_t count, size;
+} bucket;
+
+typedef struct bucketQueue {
+    bucket b[NUM_BUCKETS];
+    long fmin;
+    size_t count;
+} bucketQueue;
+
+/* false, with entry dropped, if its bucket is full and can't grow */
+static bool bucketPush(bucketQueue *bq, long f, uint64_t entry) {
+    bucket *b = &bq->b[f & (NUM_BUCKETS-1)];
+    if (b->count == b->size) {
+        size_t newSize = b->size ? b->size * 2 : STACK_INIT_SIZE;
+        uint64_t *items = (uint64_t*)realloc(b->items, sizeof(uint64_t)*newSize);
+        if (items == NULL) {
+            return false;
+        }
+        countAlloc(sizeof(uint64_t) * (newSize - b->size));
+        b->items = items;
+        b->size = newSize;
+    }
+    b->items[b->count++] = entry;
+    bq->count++;
+    return true;
+}
+
+/* pops from the lowest non-empty f; within a bucket the newest (deepest) entry wins ties */
+static uint64_t bucketPop(bucketQueue *bq, long *f) {
+    while (bq->b[bq->fmin & (NUM_BUCKETS-1)].count == 0) {
+        bq->fmin++;
+    }
+    bucket *b = &bq->b[bq->fmin & (NUM_BUCKETS-1)];
+    bq->count--;
+    *f = bq->fmin;
+    return b->items[--b->count];
+}
+
+static inline long manhattan(int x, int y, int xend, int yend) {
+    return labs((long)x - xend) + labs((long)y - yend);
+}
+
+/* A* towards the end cell. The heuristic is consistent, so the first time a
+   cell is popped its g is final and duplicates left in the queue are skipped. */
+int findPathAStar(const maze *m1, stack *path, searchState *ss) {
+    size_t endIdx = cellIndex(m1, m1->xend, m1->yend);
+    bucketQueue bq;
+    int found = 0;
+    bool queued;
+
+    /* visited here means closed */
+    if (!searchBegin(ss, m1)) {
+        return outOfMemory(m1, "the search state");
+    }
+
+    memset(&bq, 0, sizeof(bq));
+    bq.fmin = manhattan(m1->xstart, m1->ystart, m1->xend, m1->yend);
+    queued = bucketPush(&bq, bq.fmin, (uint64_t)cellIndex(m1, m1->xstart, m1->ystart) << 2);
+
+    while (queued && bq.count > 0) {
+        long f;
+        uint64_t entry = bucketPop(&bq, &f);
+        size_t idx = (size_t)(entry >> 2);
+        if (isVisited(ss, idx)) {
+            continue;
+        }
+        markVisited(ss, idx);
+        setParentDir(ss->parent, idx, (int)(entry & 3));
+        path->expanded++;
+        if (idx == endIdx) {
+            found = 1;
+            break;
+        }
+
+        int x = cellRow(m1, idx);
+        int y = cellCol(m1, idx);
+        long g = f - manhattan(x, y, m1->xend, m1->yend);
+        unsigned open = openDirs(m1, x, y);
+        for (int dir = 0; dir < 4; dir++) {
+            int nx = x + dirDx[dir];
+            int ny = y + dirDy[dir];
+            size_t next = cellIndex(m1, nx, ny);
+            if (!(open >> dir & 1) || isVisited(ss, next)) {
+                continue;
+            }
+            if (!bucketPush(&bq, g + 1 + manhattan(nx, ny, m1->xend, m1->yend),
+                            ((uint64_t)next << 2) | (uint64_t)dir)) {
+                queued = false;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        free(bq.b[i].items);
+    }
+    if (!queued) {
+        return outOfMemory(m1, "the search queue");
+    }
+    if (found && !buildPath(m1, ss->parent, path)) {
+        return outOfMemory(m1, "the path stack");
+    }
+    return found;
+}
+
+// jump point search =========================================================
+
+/* A* over jump points, for 4-connected grids. A run along y stops where a
+   cell beside it opens up just past a wall (a forced neighbour); a run
+   along x also stops where a run along y from the cell would stop, so any
+   turn a shortest path needs is at a jump point. The cells in between are
+   never queued, and runs along y are scanned 64 cells at a time on the
+   wall bitmap. Each closed jump point records the one its run started
+   from, and the path is rebuilt cell by cell along those runs, so coins on
+   skipped cells are still counted. */
+
+typedef struct jumpEntry {
+    long f, g;
+    size_t idx, from;
+} jumpEntry;
+
+/* binary min-heap on f, deepest first among equals: a jump changes f by
+   any even amount, too much for the A* bucket ring */
+typedef struct jumpHeap {
+    jumpEntry* items;
+    size_t count, size;
+} jumpHeap;
+
+typedef struct jumpLink {
+    size_t idx, from;
+} jumpLink;
+
+typedef struct jumpGrid {
+    const maze *m1;
+    const uint64_t *walls;
+    size_t words;       /* per row */
+} jumpGrid;
+
+static inline bool heapBefore(const jumpEntry *a, const jumpEntry *b) {
+    return a->f < b->f || (a->f == b->f && a->g > b->g);
+}
+
+/* false, with e dropped, if the heap is full and can't grow */
+static bool heapPush(jumpHeap *h, jumpEntry e) {
+    if (h->count == h->size) {
+        size_t newSize = h->size ? h->size * 2 : STACK_INIT_SIZE;
+        jumpEntry *items = (jumpEntry*)realloc(h->items, sizeof(jumpEntry)*newSize);
+        if (items == NULL) {
+            return false;
+        }
+        countAlloc(sizeof(jumpEntry) * (newSize - h->size));
+        h->items = items;
+        h->size = newSize;
+    }
+    size_t i = h->count++;
+    while (i > 0 && heapBefore(&e, &h->items[(i-1)/2])) {
+        h->items[i] = h->items[(i-1)/2];
+        i = (i-1)/2;
+    }
+    h->items[i] = e;
+    return true;
+}
+
+static jumpEntry heapPop(jumpHeap *h) {
+    jumpEntry top = h->items[0];
+    jumpEntry last = h->items[--h->count];
+    size_t i = 0;
+    for (;;) {
+        size_t c = 2*i + 1;
+        if (c >= h->count) {
+            break;
+        }
+        if (c + 1 < h->count && heapBefore(&h->items[c+1], &h->items[c])) {
+            c++;
+        }
+        if (!heapBefore(&h->items[c], &last)) {
+            break;
+        }
+        h->items[i] = h->items[c];
+        i = c;
+    }
+    h->items[i] = last;
+    return top;
+}
+
+static inline bool gridWall(const jumpGrid *jg, int x, int y) {
+    return (jg->walls[(size_t)x * jg->words + (unsigned)y / 64] >> ((unsigned)y % 64)) & 1;
+}
+
+/* Follow a run along y from (x, y); returns the column of the jump point
+   it reaches, or 0 if it runs into a wall first. A column stops the run
+   if it is a wall, or if the cell above or below it is open with a wall
+   just behind; both are found a word at a time. The border guarantees a
+   wall before the row runs out. */
+static int jumpY(const jumpGrid *jg, int x, int y, int dy) {
+    const maze *m1 = jg->m1;
+    const uint64_t *row = jg->walls + (size_t)x * jg->words;
+    const uint64_t *above = row - jg->words, *below = row + jg->words;
+    size_t w;
+    int c;
+
+    if (dy > 0) {
+        uint64_t mask = ~0ULL << ((unsigned)(y + 1) % 64);
+        for (w = (size_t)(y + 1) / 64; ; w++, mask = ~0ULL) {
+            uint64_t behindA = above[w] << 1 | (w ? above[w-1] >> 63 : 0);
+            uint64_t behindB = below[w] << 1 | (w ? below[w-1] >> 63 : 0);
+            uint64_t stop = (row[w] | (~above[w] & behindA) | (~below[w] & behindB)) & mask;
+            if (stop) {
+                c = (int)(w * 64) + __builtin_ctzll(stop);
+                break;
+            }
+        }
+        if (x == m1->xend && m1->yend > y && m1->yend <= c) {
+            return m1->yend;
+        }
+    } else {
+        uint64_t mask = ((unsigned)y % 64) ? ~0ULL >> (64 - (unsigned)y % 64) : 0;
+        for (w = (size_t)y / 64; ; w--, mask = ~0ULL) {
+            uint64_t behindA = above[w] >> 1 | (w + 1 < jg->words ? above[w+1] << 63 : 0);
+            uint64_t behindB = below[w] >> 1 | (w + 1 < jg->words ? below[w+1] << 63 : 0);
+            uint64_t stop = (row[w] | (~above[w] & behindA) | (~below[w] & behindB)) & mask;
+            if (stop) {
+                c = (int)(w * 64) + 63 - __builtin_clzll(stop);
+                break;
+            }
+        }
+        if (x == m1->xend && m1->yend < y && m1->yend >= c) {
+            return m1->yend;
+        }
+    }
+    return gridWall(jg, x, c) ? 0 : c;
+}
+
+/* the same along x, a cell at a time; returns the row of the jump point, or 0 */
+static int jumpX(const jumpGrid *jg, int x, int y, int dx) {
+    const maze *m1 = jg->m1;
+    for (;;) {
+        x += dx;
+        if (gridWall(jg, x, y)) {
+            return 0;
+        }
+        if ((x == m1->xend && y == m1->yend)
+            || (!gridWall(jg, x, y-1) && gridWall(jg, x-dx, y-1))
+            || (!gridWall(jg, x, y+1) && gridWall(jg, x-dx, y+1))
+            || jumpY(jg, x, y, 1) || jumpY(jg, x, y, -1)) {
+            return x;
+        }
+    }
+}
+
+static int compareLinks(const void *a, const void *b) {
+    size_t x = ((const jumpLink*)a)->idx, y = ((const jumpLink*)b)->idx;
+    return (x > y) - (x < y);
+}
+
+static inline int runDir(int dx, int dy) {
+    return dx ? (dx > 0 ? MOVE_DOWN : MOVE_UP) : (dy > 0 ? MOVE_RIGHT : MOVE_LEFT);
+}
+
+/* Extend path from start to end along the runs between jump points, as
+   buildPath does: count the steps and coins back from the end, then write
+   the moves into place from the last one back. */
+/* record that idx was reached by a run from from; false if the list can't grow */
+static bool addJumpLink(jumpLink **links, size_t *numLinks, size_t *linkSize, size_t idx, size_t from) {
+    if (*numLinks == *linkSize) {
+        size_t newSize = *linkSize ? *linkSize * 2 : STACK_INIT_SIZE;
+        jumpLink *grown = (jumpLink*)realloc(*links, sizeof(jumpLink) * newSize);
+        if (grown == NULL) {
+            return false;
+        }
+        countAlloc(sizeof(jumpLink) * (newSize - *linkSize));
+        *links = grown;
+        *linkSize = newSize;
+    }
+    (*links)[*numLinks].idx = idx;
+    (*links)[(*numLinks)++].from = from;
+    return true;
+}
+
+/* returns false if the path could not grow */
+static bool buildJumpPath(const maze *m1, jumpLink *links, size_t numLinks, stack *path) {
+    size_t startIdx = cellIndex(m1, m1->xstart, m1->ystart);
+    size_t steps = 0;
+
+    qsort(links, numLinks, sizeof(jumpLink), compareLinks);
+    for (int pass = 0; pass < 2; pass++) {
+        size_t idx = cellIndex(m1, m1->xend, m1->yend), k = steps;
+        if (pass == 1) {
+            if (is_empty(path) && push(path, m1->xstart, m1->ystart, false) == NULL) {
+                return false;
+            }
+            if (!reserveSteps(path, path->numItems - 1 + steps)) {
+                return false;
+            }
+        }
+        while (idx != startIdx) {
+            jumpLink key = { idx, 0 };
+            const jumpLink *link = (const jumpLink*)bsearch(&key, links, numLinks, sizeof(jumpLink), compareLinks);
+            int x = cellRow(m1, idx), y = cellCol(m1, idx);
+            int fx = cellRow(m1, link->from), fy = cellCol(m1, link->from);
+            int dir = runDir((x > fx) - (x < fx), (y > fy) - (y < fy));
+            for (; x != fx || y != fy; x -= dirDx[dir], y -= dirDy[dir]) {
+                if (pass == 0) {
+                    steps++;
+                    if (hasCoin(m1, cellIndex(m1, x, y))) {
+                        path->numCoins++;
+                    }
+                } else {
+                    setStepDir(path, path->numItems - 1 + --k, dir);
+                }
+            }
+            idx = link->from;
+        }
+    }
+    path->numItems += steps;
+    path->last.xpos = m1->xend;
+    path->last.ypos = m1->yend;
+    if (path->numItems > path->maxDepth) {
+        path->maxDepth = path->numItems;
+    }
+    return true;
+}
+
+int findPathJPS(const maze *m1, stack *path, searchState *ss) {
+    size_t startIdx = cellIndex(m1, m1->xstart, m1->ystart);
+    size_t endIdx = cellIndex(m1, m1->xend, m1->yend);
+    jumpHeap heap = { NULL, 0, 0 };
+    jumpLink *links = NULL;
+    size_t numLinks = 0, linkSize = 0;
+    uint64_t *built;
+    jumpGrid jg = { m1, wallBitmap(m1, &built), rowWords(m1) };
+    int found = 0;
+    bool grown;
+
+    if (jg.walls == NULL) {
+        return outOfMemory(m1, "the wall bitmap");
+    }
+    /* visited here means closed */
+    if (!searchBegin(ss, m1)) {
+        free(built);
+        return outOfMemory(m1, "the search state");
+    }
+
+    jumpEntry first = { manhattan(m1->xstart, m1->ystart, m1->xend, m1->yend), 0, startIdx, startIdx };
+    grown = heapPush(&heap, first);
+    while (grown && heap.count > 0) {
+        jumpEntry e = heapPop(&heap);
+        if (isVisited(ss, e.idx)) {
+            continue;
+        }
+        markVisited(ss, e.idx);
+        path->expanded++;
+        if (!addJumpLink(&links, &numLinks, &linkSize, e.idx, e.from)) {
+            grown = false;
+            break;
+        }
+        if (e.idx == endIdx) {
+            found = 1;
+            break;
+        }
+
+        /* every way but back the way the run came; all four from the start */
+        int x = cellRow(m1, e.idx);
+        int y = cellCol(m1, e.idx);
+        int fx = cellRow(m1, e.from), fy = cellCol(m1, e.from);
+        int back = e.idx == startIdx ? -1 : (runDir((x > fx) - (x < fx), (y > fy) - (y < fy)) + 2) & 3;
+        for (int dir = 0; dir < 4; dir++) {
+            int nx = x, ny = y;
+            if (dir == back) {
+                continue;
+            }
+            if (dirDx[dir] != 0) {
+                nx = jumpX(&jg, x, y, dirDx[dir]);
+            } else {
+                ny = jumpY(&jg, x, y, dirDy[dir]);
+            }
+            if (nx == 0 || ny == 0 || isVisited(ss, cellIndex(m1, nx, ny))) {
+                continue;
+            }
+            long g = e.g + labs((long)(nx - x)) + labs((long)(ny - y));
+            jumpEntry next = { g + manhattan(nx, ny, m1->xend, m1->yend), g, cellIndex(m1, nx, ny), e.idx };
+            if (!heapPush(&heap, next)) {
+                grown = false;
+                break;
+            }
+        }
+    }
+
+    if (grown && found) {
+        grown = buildJumpPath(m1, links, numLinks, path);
+    }
+    free(heap.items);
+    free(links);
+    free(built);
+    if (!grown) {
+        return outOfMemory(m1, "the jump point search");
+    }
+    return found;
+}
+
+// sparse jump point search ==================================================
+
+/* Jump point search on a sparse maze. The runs stop where findPathJPS's
+   would, but are found from the sorted obstacle list instead of a bitmap:
+   a run along y looks up the next wall in its own row and the wall ends
+   beside it, and a run along x skips every row that has no wall within
+   one row of it, since nothing there can stop it. Closed cells go in a
+   hash set, so memory grows with the jump points reached, not the area. */
+
+static inline uint64_t sparseKey(const maze *m1, int x, int y) {
+    return (uint64_t)x * m1->stride + (uint64_t)y;
+}
+
+static inline bool sparseWall(const maze *m1, int x, int y) {
+    return sparseType(m1, sparseKey(m1, x, y)) == '*';
+}
+
+/* the nearest row from x on, going dx, with a wall in it; a border row if none */
+static int nextWallRow(const maze *m1, int x, int dx) {
+    const sparseGrid *g = &m1->obstacles;
+    if (x < 1 || x > m1->xsize) {
+        return x < 1 ? 0 : m1->xsize + 1;
+    }
+    if (dx > 0) {
+        for (size_t i = sparseLower(g, sparseKey(m1, x, 0)); i < g->count; i++) {
+            if (g->cells[i].type == '*') {
+                return (int)(g->cells[i].key / m1->stride);
+            }
+        }
+        return m1->xsize + 1;
+    }
+    for (size_t i = sparseLower(g, sparseKey(m1, x + 1, 0)); i > 0; i--) {
+        if (g->cells[i-1].type == '*') {
+            return (int)(g->cells[i-1].key / m1->stride);
+        }
+    }
+    return 0;
+}
+
+/* First column past y, going dy, where a run along row x stops: the next
+   wall in the row, or an open cell in row r just past a wall in row r. */
+static int sparseWallEnd(const maze *m1, int x, int y, int dy, int r, int limit) {
+    const sparseGrid *g = &m1->obstacles;
+
+    if (r < 1 || r > m1->xsize) {
+        return limit;
+    }
+    if (dy > 0) {
+        for (size_t i = sparseLower(g, sparseKey(m1, r, r == x ? y + 1 : y)); i < g->count; i++) {
+            int w = (int)(g->cells[i].key % m1->stride);
+            if (g->cells[i].key >= sparseKey(m1, r + 1, 0) || w >= limit) {
+                break;
+            }
+            if (g->cells[i].type != '*') {
+                continue;
+            }
+            if (r == x) {
+                return w;
+            }
+            if (w + 1 <= m1->ysize && !sparseWall(m1, r, w + 1)) {
+                return w + 1;
+            }
+        }
+    } else {
+        for (size_t i = sparseLower(g, sparseKey(m1, r, r == x ? y : y + 1)); i > 0; i--) {
+            int w = (int)(g->cells[i-1].key % m1->stride);
+            if (g->cells[i-1].key < sparseKey(m1, r, 0) || w <= limit) {
+                break;
+            }
+            if (g->cells[i-1].type != '*') {
+                continue;
+            }
+            if (r == x) {
+                return w;
+            }
+            if (w - 1 >= 1 && !sparseWall(m1, r, w - 1)) {
+                return w - 1;
+            }
+        }
+    }
+    return limit;
+}
+
+/* as jumpY: the column of the jump point a run along y reaches, or 0 */
+static int sparseJumpY(const maze *m1, int x, int y, int dy) {
+    int c = sparseWallEnd(m1, x, y, dy, x, dy > 0 ? m1->ysize + 1 : 0);
+    c = sparseWallEnd(m1, x, y, dy, x - 1, c);
+    c = sparseWallEnd(m1, x, y, dy, x + 1, c);
+    if (x == m1->xend && (dy > 0 ? m1->yend > y && m1->yend <= c : m1->yend < y && m1->yend >= c)) {
+        return m1->yend;
+    }
+    return sparseWall(m1, x, c) ? 0 : c;
+}
+
+/* as jumpX, jumping straight over rows with no wall beside them */
+static int sparseJumpX(const maze *m1, int x, int y, int dx) {
+    for (;;) {
+        x += dx;
+        if (sparseWall(m1, x, y)) {
+            return 0;
+        }
+        if (x == m1->xend && y == m1->yend) {
+            return x;
+        }
+        int near = nextWallRow(m1, x - 1, 1);
+        if (x != m1->xend && near > x + 1) {
+            /* rows x to the next wall row's neighbour are all clear */
+            int r = nextWallRow(m1, x + 2 * dx, dx) - dx;
+            if ((m1->xend - x) * dx > 0 && (r - m1->xend) * dx > 0) {
+                r = m1->xend;
+            }
+            x = r - dx;
+            continue;
+        }
+        if ((!sparseWall(m1, x, y-1) && sparseWall(m1, x-dx, y-1))
+            || (!sparseWall(m1, x, y+1) && sparseWall(m1, x-dx, y+1))
+            || sparseJumpY(m1, x, y, 1) || sparseJumpY(m1, x, y, -1)) {
+            return x;
+        }
+    }
+}
+
+int findPathSparse(const maze *m1, stack *path, bool debugMode) {
+    size_t startIdx = cellIndex(m1, m1->xstart, m1->ystart);
+    size_t endIdx = cellIndex(m1, m1->xend, m1->yend);
+    jumpHeap heap = { NULL, 0, 0 };
+    jumpLink *links = NULL;
+    size_t numLinks = 0, linkSize = 0;
+    coinSet closed;
+    int found = 0;
+    bool grown;
+
+    memset(&closed, 0, sizeof(closed));
+    jumpEntry first = { manhattan(m1->xstart, m1->ystart, m1->xend, m1->yend), 0, startIdx, startIdx };
+    grown = heapPush(&heap, first);
+    while (grown && heap.count > 0) {
+        jumpEntry e = heapPop(&heap);
+        if (!coinAdd(&closed, e.idx)) {
+            continue;
+        }
+        path->expanded++;
+        int x = cellRow(m1, e.idx);
+        int y = cellCol(m1, e.idx);
+        if (debugMode) {
+            traceRecord(TRACE_JUMP, x, y);
+        }
+        if (!addJumpLink(&links, &numLinks, &linkSize, e.idx, e.from)) {
+            grown = false;
+            break;
+        }
+        if (e.idx == endIdx) {
+            found = 1;
+            break;
+        }
+
+        int fx = cellRow(m1, e.from), fy = cellCol(m1, e.from);
+        int back = e.idx == startIdx ? -1 : (runDir((x > fx) - (x < fx), (y > fy) - (y < fy)) + 2) & 3;
+        for (int dir = 0; dir < 4; dir++) {
+            int nx = x, ny = y;
+            if (dir == back) {
+                continue;
+            }
+            if (dirDx[dir] != 0) {
+                nx = sparseJumpX(m1, x, y, dirDx[dir]);
+            } else {
+                ny = sparseJumpY(m1, x, y, dirDy[dir]);
+            }
+            if (nx == 0 || ny == 0 || coinHas(&closed, cellIndex(m1, nx, ny))) {
+                continue;
+            }
+            long g = e.g + labs((long)(nx - x)) + labs((long)(ny - y));
+            jumpEntry next = { g + manhattan(nx, ny, m1->xend, m1->yend), g, cellIndex(m1, nx, ny), e.idx };
+            if (!heapPush(&heap, next)) {
+                grown = false;
+                break;
+            }
+        }
+    }
+
+    if (grown && found) {
+        grown = buildJumpPath(m1, links, numLinks, path);
+    }
+    free(heap.items);
+    free(links);
+    coinFree(&closed);
+    if (!grown) {
+        return outOfMemory(m1, "the jump point search");
+    }
+    return found;
+}
+
+// coin route solver =========================================================
+
+/* The route through the most coins (-m), shortest among those, within an
+   optional step budget (-l). Coins the start can reach, and that leave
+   enough of the budget to reach the end, become the nodes of a small graph
+   with the start and end; a BFS from each gives the distances between
+   them. With more than COIN_NEIGHBOURS coins, each coin's BFS stops once
+   it has reached that many others, so it stays local and the graph only
+   links near neighbours; a coin whose links are all used up is linked
+   further out when the search gets there. Up to COIN_DP_MAX coins the best order is found
+   exactly by dynamic programming over subsets. Beyond that a depth-first
+   branch and bound, nearest coins first, keeps the best route found within
+   COIN_SEARCH_LIMIT units of work. Either way the route is walked leg by
+   leg with BFS, and each coin on it counts once, wherever on the route it
+   lies. */
+#define COIN_DP_MAX 16
+#define COIN_NEIGHBOURS 32
+#define COIN_ROUTE_MAX 2048
+#define COIN_SEARCH_LIMIT (1L << 26)
+#define NO_DISTANCE UINT32_MAX
+
+typedef struct coinGraph {
+    size_t numCoins;
+    size_t *cells;          /* coin cell indices, sorted */
+    uint32_t *dist;         /* numCoins x numCoins */
+    uint32_t *fromStart, *toEnd;
+    uint32_t direct;        /* start to end with no coins */
+    long budget;
+    bool *full;             /* coin i is linked to every coin in reach */
+    const maze *m1;         /* for linking further out during the search */
+    searchState *ss;
+    cellQueue *q;           /* q->failed marks the graph as out of memory */
+    size_t expanded;
+} coinGraph;
+
+/* a coin and the distance it is sorted by */
+typedef struct keyedCoin {
+    uint32_t key;
+    uint32_t coin;
+} keyedCoin;
+
+/* a route: coins in visiting order, and its steps from start to end */
+typedef struct coinRoute {
+    size_t *order;
+    size_t numCoins;
+    long length;
+} coinRoute;
+
+static int compareCells(const void *a, const void *b) {
+    size_t x = *(const size_t*)a, y = *(const size_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int compareKeyed(const void *a, const void *b) {
+    const keyedCoin *x = (const keyedCoin*)a, *y = (const keyedCoin*)b;
+    if (x->key != y->key) {
+        return (x->key > y->key) - (x->key < y->key);
+    }
+    return (x->coin > y->coin) - (x->coin < y->coin);
+}
+
+/* every coin cell of the maze, sorted; NULL if the list can't be allocated */
+static size_t *listCoins(const maze *m1, size_t *numCoins) {
+    size_t n = 0, cap = m1->arr ? 64 : m1->coins.count + 1;
+    size_t *cells = (size_t*)malloc(sizeof(size_t) * cap);
+
+    if (cells == NULL) {
+        return NULL;
+    }
+    if (m1->arr) {
+        for (size_t idx = 0; idx < numCells(m1); idx++) {
+            if (m1->arr[idx] == 'C') {
+                if (n == cap) {
+                    size_t *grown = (size_t*)realloc(cells, sizeof(size_t) * cap * 2);
+                    if (grown == NULL) {
+                        free(cells);
+                        return NULL;
+                    }
+                    cells = grown;
+                    cap *= 2;
+                }
+                cells[n++] = idx;
+            }
+        }
+    } else {
+        for (size_t i = 0; m1->coins.keys != NULL && i <= m1->coins.mask; i++) {
+            if (m1->coins.keys[i] != 0) {
+                cells[n++] = (size_t)(m1->coins.keys[i] - 1);
+            }
+        }
+        qsort(cells, n, sizeof(size_t), compareCells);
+    }
+    countAlloc(sizeof(size_t) * cap);
+    *numCoins = n;
+    return cells;
+}
+
+/* Steps from cell from to each of cells[0..n) into row (NO_DISTANCE where
+   out of reach), going no further than budget steps and stopping once want
+   of the coins and the end have been reached. Coins marked in skip get
+   their distance but don't count towards want. Returns the steps to the
+   end the same way. Running out of memory sets q->failed, which stays set. */
+static uint32_t coinBFS(const maze *m1, searchState *ss, cellQueue *q, size_t from, const size_t *cells,
+                        size_t n, size_t want, const bool *skip, uint32_t *row, long budget, size_t *expanded) {
+    size_t endIdx = cellIndex(m1, m1->xend, m1->yend);
+    size_t reached = 0;
+    uint32_t toEnd = NO_DISTANCE;
+
+    for (size_t i = 0; i < n; i++) {
+        row[i] = NO_DISTANCE;
+    }
+    if (q->failed || !searchBegin(ss, m1)) {
+        q->failed = true;
+        return toEnd;
+    }
+    markVisited(ss, from);
+    queuePush(q, from);
+    for (long depth = 0; q->count > 0 && !q->failed && reached < want && depth <= budget; depth++) {
+        for (size_t level = q->count; level > 0 && !q->failed; level--) {
+            size_t idx = queuePop(q);
+            (*expanded)++;
+            if (idx == endIdx) {
+                toEnd = (uint32_t)depth;
+                reached++;
+            } else if (hasCoin(m1, idx)) {
+                const size_t *hit = (const size_t*)bsearch(&idx, cells, n, sizeof(size_t), compareCells);
+                if (hit != NULL) {
+                    row[hit - cells] = (uint32_t)depth;
+                    reached += skip == NULL || !skip[hit - cells];
+                }
+            }
+            unsigned open = openDirs(m1, cellRow(m1, idx), cellCol(m1, idx));
+            for (int dir = 0; dir < 4; dir++) {
+                size_t next = stepCell(m1, idx, dir);
+                if ((open >> dir & 1) && !isVisited(ss, next)) {
+                    markVisited(ss, next);
+                    if (!queuePush(q, next)) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    q->head = q->count = 0;
+    return toEnd;
+}
+
+static inline bool routeBetter(size_t coins, long length, const coinRoute *best) {
+    return coins > best->numCoins || (coins == best->numCoins && length < best->length);
+}
+
+/* exact: dp[mask][i] is the shortest walk from the start through the coins in mask, ending at coin i */
+static bool coinRouteDP(const coinGraph *g, coinRoute *best) {
+    size_t k = g->numCoins;
+    size_t states = (size_t)1 << k;
+    uint32_t *dp = (uint32_t*)malloc(sizeof(uint32_t) * states * (k ? k : 1));
+
+    if (dp == NULL) {
+        return false;
+    }
+    countAlloc(sizeof(uint32_t) * states * k);
+    for (size_t n = 0; n < states * k; n++) {
+        dp[n] = NO_DISTANCE;
+    }
+    for (size_t i = 0; i < k; i++) {
+        dp[((size_t)1 << i) * k + i] = g->fromStart[i];
+    }
+
+    size_t bestMask = 0, bestLast = 0;
+    for (size_t mask = 1; mask < states; mask++) {
+        for (size_t i = 0; i < k; i++) {
+            uint32_t d = dp[mask * k + i];
+            if (d == NO_DISTANCE) {
+                continue;
+            }
+            long length = (long)d + g->toEnd[i];
+            if (routeBetter((size_t)__builtin_popcountll(mask), length, best)) {
+                best->numCoins = (size_t)__builtin_popcountll(mask);
+                best->length = length;
+                bestMask = mask;
+                bestLast = i;
+            }
+            for (size_t j = 0; j < k; j++) {
+                if (mask >> j & 1) {
+                    continue;
+                }
+                uint32_t nd = d + g->dist[i * k + j];
+                size_t next = (mask | (size_t)1 << j) * k + j;
+                if ((long)nd + g->toEnd[j] <= g->budget && nd < dp[next]) {
+                    dp[next] = nd;
+                }
+            }
+        }
+    }
+
+    /* walk the table back from the best end state */
+    for (size_t mask = bestMask, i = bestLast, n = best->numCoins; n > 0; n--) {
+        best->order[n-1] = i;
+        size_t prev = mask & ~((size_t)1 << i);
+        for (size_t j = 0; prev != 0 && j < k; j++) {
+            if ((prev >> j & 1) && dp[prev * k + j] != NO_DISTANCE
+                && dp[prev * k + j] + g->dist[j * k + i] == dp[mask * k + i]) {
+                i = j;
+                break;
+            }
+        }
+        mask = prev;
+    }
+    free(dp);
+    return true;
+}
+
+/* list the coins in order of key, unlinked (NO_DISTANCE) ones last */
+static void sortNear(const uint32_t *key, size_t k, size_t *list, keyedCoin *keyed) {
+    for (size_t j = 0; j < k; j++) {
+        keyed[j].key = key[j];
+        keyed[j].coin = (uint32_t)j;
+    }
+    qsort(keyed, k, sizeof(keyedCoin), compareKeyed);
+    for (size_t j = 0; j < k; j++) {
+        list[j] = keyed[j].coin;
+    }
+}
+
+/* Link coin i to COIN_NEIGHBOURS more unused coins, or to every coin left
+   in reach. Its earlier BFS finished the level it stopped on, so every new
+   link is longer than the old ones and its list only grows at the end.
+   Returns the cells the BFS expanded. */
+static size_t linkMore(coinGraph *g, size_t i, const bool *used, size_t *list, keyedCoin *keyed, bool *skip) {
+    size_t k = g->numCoins;
+    uint32_t *row = &g->dist[i * k];
+
+    for (size_t j = 0; j < k; j++) {
+        skip[j] = used[j] || row[j] != NO_DISTANCE;
+    }
+    size_t before = g->expanded;
+    coinBFS(g->m1, g->ss, g->q, g->cells[i], g->cells, k, COIN_NEIGHBOURS, skip, row, g->budget, &g->expanded);
+    size_t linked = 0;
+    for (size_t j = 0; j < k; j++) {
+        linked += !skip[j] && row[j] != NO_DISTANCE;
+    }
+    g->full[i] = linked < COIN_NEIGHBOURS;
+    sortNear(row, k, list, keyed);
+    return g->expanded - before;
+}
+
+/* Depth-first over coin orders, nearest next coin first, so the first
+   descent is the greedy route. Only linked coins are moved between. A node
+   is cut when even taking every coin still within reach from it could not
+   beat the best route; a coin with no link counts as no distance away, so
+   the cut stays safe. Returns whether the search ran to the end, proving
+   the route best over the graph. */
+static bool coinRouteSearch(coinGraph *g, coinRoute *best) {
+    size_t k = g->numCoins;
+    size_t *near = (size_t*)malloc(sizeof(size_t) * (k + 1) * k);
+    keyedCoin *keyed = (keyedCoin*)malloc(sizeof(keyedCoin) * (k + 1));
+    size_t *route = (size_t*)malloc(sizeof(size_t) * (k + 1));
+    size_t *pos = (size_t*)malloc(sizeof(size_t) * (k + 1));
+    long *length = (long*)malloc(sizeof(long) * (k + 1));
+    bool *used = (bool*)calloc(k, sizeof(bool));
+    bool *skip = (bool*)malloc(sizeof(bool) * (k + 1));
+    long work = 0;
+
+    if (near == NULL || keyed == NULL || route == NULL || pos == NULL || length == NULL
+        || used == NULL || skip == NULL) {
+        g->q->failed = true;
+        free(near);
+        free(keyed);
+        free(route);
+        free(pos);
+        free(length);
+        free(used);
+        free(skip);
+        return false;
+    }
+    countAlloc(sizeof(size_t) * ((k + 1) * k + 2 * (k + 1)) + sizeof(keyedCoin) * (k + 1)
+               + sizeof(long) * (k + 1) + 2 * k + 1);
+
+    /* candidate lists: row i for coin i, row k for the start */
+    for (size_t i = 0; i <= k; i++) {
+        sortNear(i < k ? &g->dist[i * k] : g->fromStart, k, &near[i * k], keyed);
+    }
+
+    size_t depth = 0;
+    pos[0] = 0;
+    length[0] = 0;
+    while (work < COIN_SEARCH_LIMIT && !g->q->failed) {
+        size_t from = depth == 0 ? k : route[depth-1];
+        size_t *list = &near[from * k];
+        const uint32_t *step = from == k ? g->fromStart : &g->dist[from * k];
+        size_t next = k;
+
+        while (pos[depth] < k) {
+            size_t j = list[pos[depth]];
+            if (step[j] == NO_DISTANCE) {
+                /* the start reaches every coin, so only a coin's links run out */
+                if (from == k || g->full[from]) {
+                    pos[depth] = k;
+                } else {
+                    work += (long)linkMore(g, from, used, list, keyed, skip);
+                }
+                continue;
+            }
+            pos[depth]++;
+            if (!used[j] && length[depth] + step[j] + g->toEnd[j] <= g->budget) {
+                next = j;
+                break;
+            }
+        }
+        work++;
+        if (next == k) {
+            if (depth == 0) {
+                break;
+            }
+            used[route[--depth]] = false;
+            continue;
+        }
+
+        route[depth] = next;
+        used[next] = true;
+        length[depth+1] = length[depth] + step[next];
+        depth++;
+        pos[depth] = 0;
+        if (routeBetter(depth, length[depth] + g->toEnd[next], best)) {
+            best->numCoins = depth;
+            best->length = length[depth] + g->toEnd[next];
+            memcpy(best->order, route, sizeof(size_t) * depth);
+        }
+
+        /* at best every unused coin still in reach from here */
+        size_t bound = depth;
+        for (size_t j = 0; j < k; j++) {
+            uint32_t d = g->dist[next * k + j];
+            bound += !used[j] && length[depth] + (d == NO_DISTANCE ? 0 : d) + g->toEnd[j] <= g->budget;
+        }
+        work += (long)k;
+        if (bound < best->numCoins
+            || (bound == best->numCoins && length[depth] + g->toEnd[next] >= best->length)) {
+            used[route[--depth]] = false;
+        }
+    }
+
+    free(near);
+    free(keyed);
+    free(route);
+    free(pos);
+    free(length);
+    free(used);
+    free(skip);
+    return work < COIN_SEARCH_LIMIT;
+}
+
+/* coins on the path, each counted once however often the route passes it */
+static int countDistinctCoins(const maze *m1, const stack *path) {
+    coinSet seen;
+    pathCursor c;
+    int coins = 0;
+
+    memset(&seen, 0, sizeof(seen));
+    for (pathBegin(&c, path); c.at < path->numItems; pathNext(&c)) {
+        size_t idx = cellIndex(m1, c.cell.xpos, c.cell.ypos);
+        if (hasCoin(m1, idx) && coinAdd(&seen, idx)) {
+            coins++;
+        }
+    }
+    coinFree(&seen);
+    return coins;
+}
+
+int findPathCoins(const maze *m1, stack *path, searchState *ss, long budget) {
+    size_t startIdx = cellIndex(m1, m1->xstart, m1->ystart);
+    size_t endIdx = cellIndex(m1, m1->xend, m1->yend);
+    size_t total = 0, expanded = 0, k = 0, inReach = 0;
+    size_t *cells = listCoins(m1, &total);
+    uint32_t *fromStart = (uint32_t*)malloc(sizeof(uint32_t) * (total + 1));
+    uint32_t *toEnd = (uint32_t*)malloc(sizeof(uint32_t) * (total + 1));
+    keyedCoin *keep = NULL;
+    coinRoute best = { NULL, 0, 0 };
+    cellQueue q;
+    coinGraph g;
+    int found = 0;
+    bool legFailed = false;
+
+    /* each stage runs only while the ones before it found a route and had memory */
+    memset(&g, 0, sizeof(g));
+    bool ok = queueInit(&q, 2 * ((size_t)m1->xsize + m1->ysize + 4))
+              && cells != NULL && fromStart != NULL && toEnd != NULL;
+
+    /* only coins on some start-to-end route within the budget matter */
+    if (ok) {
+        g.budget = budget;
+        g.direct = coinBFS(m1, ss, &q, startIdx, cells, total, total + 1, NULL, fromStart, budget, &expanded);
+        coinBFS(m1, ss, &q, endIdx, cells, total, total + 1, NULL, toEnd, budget, &expanded);
+        ok = !q.failed;
+        found = ok && g.direct != NO_DISTANCE && (long)g.direct <= budget;
+    }
+    if (found) {
+        keep = (keyedCoin*)malloc(sizeof(keyedCoin) * (total + 1));
+        ok = keep != NULL;
+    }
+    if (found && ok) {
+        for (size_t i = 0; i < total; i++) {
+            if (fromStart[i] != NO_DISTANCE && toEnd[i] != NO_DISTANCE
+                && (long)fromStart[i] + toEnd[i] <= budget) {
+                keep[k].key = fromStart[i] + toEnd[i];
+                keep[k++].coin = (uint32_t)i;
+            }
+        }
+        /* past COIN_ROUTE_MAX, keep the coins that cost the least to take in,
+           then put them back in cell order */
+        inReach = k;
+        if (k > COIN_ROUTE_MAX) {
+            qsort(keep, k, sizeof(keyedCoin), compareKeyed);
+            k = COIN_ROUTE_MAX;
+            for (size_t i = 0; i < k; i++) {
+                keep[i].key = keep[i].coin;
+            }
+            qsort(keep, k, sizeof(keyedCoin), compareKeyed);
+        }
+
+        g.numCoins = k;
+        g.cells = (size_t*)malloc(sizeof(size_t) * (k + 1));
+        g.fromStart = (uint32_t*)malloc(sizeof(uint32_t) * (k + 1));
+        g.toEnd = (uint32_t*)malloc(sizeof(uint32_t) * (k + 1));
+        g.dist = (uint32_t*)malloc(sizeof(uint32_t) * (k * k + 1));
+        g.full = (bool*)malloc(sizeof(bool) * (k + 1));
+        best.order = (size_t*)malloc(sizeof(size_t) * (k + 1));
+        ok = g.cells != NULL && g.fromStart != NULL && g.toEnd != NULL && g.dist != NULL
+             && g.full != NULL && best.order != NULL;
+    }
+    if (found && ok) {
+        countAlloc(sizeof(size_t) * (total + k + 2) + sizeof(keyedCoin) * (total + 1)
+                   + sizeof(uint32_t) * (2 * total + 2 * k + k * k + 5) + k + 1);
+        for (size_t i = 0; i < k; i++) {
+            g.cells[i] = cells[keep[i].coin];
+            g.fromStart[i] = fromStart[keep[i].coin];
+            g.toEnd[i] = toEnd[keep[i].coin];
+        }
+        /* each coin's own cell is the first target it reaches */
+        bool complete = k <= COIN_NEIGHBOURS;
+        size_t want = complete ? k + 1 : COIN_NEIGHBOURS + 1;
+        for (size_t i = 0; i < k; i++) {
+            coinBFS(m1, ss, &q, g.cells[i], g.cells, k, want, NULL, &g.dist[i * k], budget, &expanded);
+            g.full[i] = complete;
+        }
+        g.m1 = m1;
+        g.ss = ss;
+        g.q = &q;
+        g.expanded = expanded;
+
+        best.length = (long)g.direct;
+        bool proven = !q.failed
+                      && ((k <= COIN_DP_MAX && coinRouteDP(&g, &best)) || coinRouteSearch(&g, &best));
+        expanded = g.expanded;
+        ok = !q.failed;
+        if (ok) {
+            fprintf(m1->out, "Coin route: %zu of %zu coins in reach, %zu on the route (%s), %ld steps\n",
+                    k, inReach, best.numCoins, proven && complete && k == inReach ? "best" : "best found",
+                    best.length);
+        }
+    }
+    path->expanded += expanded;
+    if (found && ok) {
+        /* walk the legs; each leg's BFS appends to the path from where it stands */
+        maze leg = *m1;
+        for (size_t n = 0; ok && n <= best.numCoins; n++) {
+            size_t to = n < best.numCoins ? g.cells[best.order[n]] : endIdx;
+            leg.xend = cellRow(m1, to);
+            leg.yend = cellCol(m1, to);
+            legFailed = findPathBFS(&leg, path, ss) < 0;
+            ok = !legFailed;
+            leg.xstart = leg.xend;
+            leg.ystart = leg.yend;
+        }
+        path->numCoins = countDistinctCoins(m1, path);
+    }
+
+    free(best.order);
+    free(g.cells);
+    free(g.fromStart);
+    free(g.toEnd);
+    free(g.dist);
+    free(g.full);
+    free(keep);
+    free(cells);
+    free(fromStart);
+    free(toEnd);
+    free(q.items);
+    if (!ok) {
+        /* a leg's BFS has already said what it ran out of */
+        return legFailed ? -1 : outOfMemory(m1, "the coin route");
+    }
+    return found;
+}
+
+// out-of-core breadth-first solver ==========================================
+
+/* Breadth-first search on an out-of-core maze, a level at a time. Each
+   level's frontier is sorted by cell index before it is expanded; in the
+   tiled layout that groups the cells of a tile together, so a tile is
+   brought in about once per level rather than once per cell. Visited bits
+   and parent directions are written into the cells themselves. */
+
+/* false, with the frontier unchanged, if it can't grow */
+static bool growFrontier(size_t **cells, size_t *size, size_t need) {
+    if (need <= *size) {
+        return true;
+    }
+    size_t newSize = *size ? *size : STACK_INIT_SIZE;
+    while (newSize < need) {
+        newSize *= 2;
+    }
+    size_t *grown = (size_t*)realloc(*cells, sizeof(size_t) * newSize);
+    if (grown == NULL) {
+        return false;
+    }
+    countAlloc(sizeof(size_t) * (newSize - *size));
+    *cells = grown;
+    *size = newSize;
+    return true;
+}
+
+/* as buildPath, with the parent directions read from the tiles */
+static bool buildDiskPath(const maze *m1, stack *path) {
+    size_t steps = 0;
+    int x = m1->xend, y = m1->yend;
+
+    while (x != m1->xstart || y != m1->ystart) {
+        uint8_t cell = *diskCell(m1, cellIndex(m1, x, y), false);
+        steps++;
+        if ((cell & DISK_TYPE) == DISK_COIN) {
+            path->numCoins++;
+        }
+        int dir = cell >> DISK_PARENT_SHIFT & 3;
+        x -= dirDx[dir];
+        y -= dirDy[dir];
+    }
+    if (push(path, x, y, false) == NULL || !reserveSteps(path, steps)) {
+        return false;
+    }
+
+    x = m1->xend;
+    y = m1->yend;
+    for (size_t k = steps; k > 0; k--) {
+        int dir = *diskCell(m1, cellIndex(m1, x, y), false) >> DISK_PARENT_SHIFT & 3;
+        setStepDir(path, k - 1, dir);
+        x -= dirDx[dir];
+        y -= dirDy[dir];
+    }
+    path->numItems += steps;
+    path->last.xpos = m1->xend;
+    path->last.ypos = m1->yend;
+    if (path->numItems > path->maxDepth) {
+        path->maxDepth = path->numItems;
+    }
+    return true;
+}
+
+int findPathOutOfCore(const maze *m1, stack *path) {
+    tileCache *tc = m1->disk;
+    size_t startIdx = cellIndex(m1, m1->xstart, m1->ystart);
+    size_t endIdx = cellIndex(m1, m1->xend, m1->yend);
+    size_t *cur = NULL, *next = NULL;
+    size_t curSize = 0, nextSize = 0, curCount = 1, nextCount;
+    int found = 0;
+
+    if (!growFrontier(&cur, &curSize, 1)) {
+        return outOfMemory(m1, "the frontier");
+    }
+    cur[0] = startIdx;
+    *diskCell(m1, startIdx, true) |= DISK_VISITED;
+    while (curCount > 0 && !found) {
+        qsort(cur, curCount, sizeof(size_t), compareCells);
+        nextCount = 0;
+        for (size_t n = 0; n < curCount; n++) {
+            size_t idx = cur[n];
+            path->expanded++;
+            if (idx == endIdx) {
+                found = 1;
+                break;
+            }
+            unsigned open = openDirs(m1, cellRow(m1, idx), cellCol(m1, idx));
+            if (!growFrontier(&next, &nextSize, nextCount + 4)) {
+                found = -1;
+                break;
+            }
+            for (int dir = 0; dir < 4; dir++) {
+                if (!(open >> dir & 1)) {
+                    continue;
+                }
+                size_t nb = stepCell(m1, idx, dir);
+                uint8_t *cell = diskCell(m1, nb, false);
+                if (*cell & DISK_VISITED) {
+                    continue;
+                }
+                *diskCell(m1, nb, true) = (uint8_t)(*cell | DISK_VISITED | dir << DISK_PARENT_SHIFT);
+                next[nextCount++] = nb;
+            }
+        }
+        size_t *swap = cur;
+        cur = next;
+        next = swap;
+        size_t swapSize = curSize;
+        curSize = nextSize;
+        nextSize = swapSize;
+        curCount = found ? 0 : nextCount;
+    }
+
+    if (found > 0 && !buildDiskPath(m1, path)) {
+        found = -1;
+    }
+    size_t accesses = tc->hits + tc->misses;
+    fprintf(m1->out, "Tile cache: %zu slots of %d KB, %.2f%% of %zu accesses hit, %llu KB read, %llu KB written\n",
+            tc->slots, TILE_CELLS / 1024, accesses ? 100.0 * (double)tc->hits / (double)accesses : 100.0,
+            accesses, (unsigned long long)(tc->bytesRead >> 10), (unsigned long long)(tc->bytesWritten >> 10));
+    free(cur);
+    free(next);
+    if (found < 0) {
+        return outOfMemory(m1, "the frontier");
+    }
+    return found;
+}
+
+// parallel breadth-first solver =============================================
+
+/* Level-synchronous BFS: every thread expands a share of the current
+   frontier, claims cells with a compare-and-swap on their visit stamp,
+   and collects the cells it claimed in its own buffer. After a barrier the
+   buffers are concatenated into the next frontier at offsets from a prefix
+   sum, so no lock is taken on the frontier itself. */
+#define FRONTIER_CHUNK 256
+
+typedef struct frontierSearch {
+    const maze *m1;
+    uint16_t *stamp;
+    uint16_t epoch;
+    uint64_t *seen;             /* instead of stamp for a packed maze */
+    uint8_t *parent;
+    size_t *cur, *next;
+    size_t curCount, curSize;
+    size_t nextCount, nextSize;
+    size_t cursor;              /* next unclaimed chunk of cur */
+    size_t endIdx;
+    int found;
+    bool done;
+    bool failed;                /* a frontier could not grow; the search stops */
+    size_t expanded;
+    int numThreads;
+    size_t *localCount;
+    size_t *offset;
+    pthread_barrier_t barrier;
+} frontierSearch;
+
+typedef struct frontierWorker {
+    frontierSearch *fs;
+    int id;
+    size_t *items;
+    size_t count, size;
+} frontierWorker;
+
+/* a cell that can't be kept fails the whole search */
+static void frontierAppend(frontierWorker *w, size_t idx) {
+    if (w->count == w->size) {
+        size_t newSize = w->size ? w->size * 2 : STACK_INIT_SIZE;
+        size_t *items = (size_t*)realloc(w->items, sizeof(size_t)*newSize);
+        if (items == NULL) {
+            __atomic_store_n(&w->fs->failed, true, __ATOMIC_RELAXED);
+            return;
+        }
+        w->items = items;
+        w->size = newSize;
+    }
+    w->items[w->count++] = idx;
+}
+
+static void *frontierWorkerMain(void *arg) {
+    frontierWorker *w = (frontierWorker*)arg;
+    frontierSearch *fs = w->fs;
+    const maze *m1 = fs->m1;
+    size_t expanded = 0;
+
+    while (!fs->done) {
+        /* expand: take chunks of the frontier until it runs out */
+        w->count = 0;
+        for (;;) {
+            size_t begin = __atomic_fetch_add(&fs->cursor, FRONTIER_CHUNK, __ATOMIC_RELAXED);
+            if (begin >= fs->curCount) {
+                break;
+            }
+            size_t end = begin + FRONTIER_CHUNK < fs->curCount ? begin + FRONTIER_CHUNK : fs->curCount;
+            for (size_t n = begin; n < end; n++) {
+                size_t idx = fs->cur[n];
+                unsigned open = openDirs(m1, cellRow(m1, idx), cellCol(m1, idx));
+                expanded++;
+                for (int dir = 0; dir < 4; dir++) {
+                    if (!(open >> dir & 1)) {
+                        continue;
+                    }
+                    size_t nb = stepCell(m1, idx, dir);
+                    if (fs->seen != NULL) {
+                        uint64_t bit = (uint64_t)1 << (nb & 63);
+                        if ((__atomic_load_n(&fs->seen[nb >> 6], __ATOMIC_RELAXED) & bit)
+                            || (__atomic_fetch_or(&fs->seen[nb >> 6], bit, __ATOMIC_RELAXED) & bit)) {
+                            continue;   /* visited, or another thread claimed it first */
+                        }
+                    } else {
+                        uint16_t seen = __atomic_load_n(&fs->stamp[nb], __ATOMIC_RELAXED);
+                        if (seen == fs->epoch) {
+                            continue;
+                        }
+                        if (!__atomic_compare_exchange_n(&fs->stamp[nb], &seen, fs->epoch, false,
+                                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                            continue;   /* another thread claimed it first */
+                        }
+                    }
+                    /* only the claimant writes this cell's parent bits, but
+                       neighbours in the same byte may be written at once */
+                    unsigned shift = (nb & 3) * 2;
+                    __atomic_fetch_and(&fs->parent[nb >> 2], (uint8_t)~(3u << shift), __ATOMIC_RELAXED);
+                    __atomic_fetch_or(&fs->parent[nb >> 2], (uint8_t)(dir << shift), __ATOMIC_RELAXED);
+                    if (nb == fs->endIdx) {
+                        __atomic_store_n(&fs->found, 1, __ATOMIC_RELAXED);
+                    }
+                    frontierAppend(w, nb);
+                }
+            }
+        }
+        fs->localCount[w->id] = w->count;
+        pthread_barrier_wait(&fs->barrier);
+
+        /* merge: one thread sizes the next frontier and hands out offsets */
+        if (w->id == 0) {
+            size_t total = 0;
+            for (int t = 0; t < fs->numThreads; t++) {
+                fs->offset[t] = total;
+                total += fs->localCount[t];
+            }
+            if (total > fs->nextSize && !fs->failed) {
+                free(fs->next);
+                fs->next = (size_t*)malloc(sizeof(size_t)*total);
+                fs->nextSize = fs->next != NULL ? total : 0;
+                fs->failed = fs->next == NULL;
+            }
+            fs->nextCount = fs->failed ? 0 : total;
+        }
+        pthread_barrier_wait(&fs->barrier);
+
+        if (w->count > 0 && !fs->failed) {
+            memcpy(fs->next + fs->offset[w->id], w->items, sizeof(size_t) * w->count);
+        }
+        pthread_barrier_wait(&fs->barrier);
+
+        if (w->id == 0) {
+            size_t *tmp = fs->cur;
+            size_t tmpSize = fs->curSize;
+            fs->cur = fs->next;
+            fs->curSize = fs->nextSize;
+            fs->curCount = fs->nextCount;
+            fs->next = tmp;
+            fs->nextSize = tmpSize;
+            fs->cursor = 0;
+            fs->done = fs->found || fs->curCount == 0 || fs->failed;
+        }
+        pthread_barrier_wait(&fs->barrier);
+    }
+
+    __atomic_fetch_add(&fs->expanded, expanded, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+/* Shortest path using threads workers (0 means one per online CPU). */
+int findPathParallel(const maze *m1, stack *path, searchState *ss, int threads) {
+    size_t startIdx = cellIndex(m1, m1->xstart, m1->ystart);
+    frontierSearch fs;
+
+    if (threads < 1) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (int)online : 1;
+    }
+
+    memset(&fs, 0, sizeof(fs));
+    fs.m1 = m1;
+    fs.numThreads = threads;
+    fs.endIdx = cellIndex(m1, m1->xend, m1->yend);
+    fs.cur = (size_t*)malloc(sizeof(size_t));
+    fs.localCount = (size_t*)calloc((size_t)threads, sizeof(size_t));
+    fs.offset = (size_t*)calloc((size_t)threads, sizeof(size_t));
+    frontierWorker *workers = (frontierWorker*)calloc((size_t)threads, sizeof(frontierWorker));
+    pthread_t *tids = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)threads);
+    if (!searchBegin(ss, m1) || fs.cur == NULL || fs.localCount == NULL || fs.offset == NULL
+        || workers == NULL || tids == NULL) {
+        free(fs.cur);
+        free(fs.localCount);
+        free(fs.offset);
+        free(workers);
+        free(tids);
+        return outOfMemory(m1, "the search state");
+    }
+    fs.stamp = ss->stamp;
+    fs.epoch = ss->epoch;
+    fs.seen = ss->seen;
+    fs.parent = ss->parent;
+
+    markVisited(ss, startIdx);
+    fs.cur[0] = startIdx;
+    fs.curCount = fs.curSize = 1;
+    fs.found = (startIdx == fs.endIdx);
+    fs.done = fs.found;
+    pthread_barrier_init(&fs.barrier, NULL, (unsigned)threads);
+
+    for (int t = 0; t < threads; t++) {
+        workers[t].fs = &fs;
+        workers[t].id = t;
+    }
+    for (int t = 1; t < threads; t++) {
+        pthread_create(&tids[t], NULL, frontierWorkerMain, &workers[t]);
+    }
+    frontierWorkerMain(&workers[0]);
+    for (int t = 1; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+
+    path->expanded = fs.expanded;
+    if (fs.found && !fs.failed) {
+        fs.failed = !buildPath(m1, fs.parent, path);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        free(workers[t].items);
+    }
+    pthread_barrier_destroy(&fs.barrier);
+    free(workers);
+    free(tids);
+    free(fs.localCount);
+    free(fs.offset);
+    free(fs.cur);
+    free(fs.next);
+    if (fs.failed) {
+        return outOfMemory(m1, "the frontier");
+    }
+    return fs.found;
+}
+
+// bit-parallel reachability =================================================
+
+/* Whether the end can be reached at all, without a path: the reachable set
+   is kept as a bitmap laid out like the packed walls and grown a span of
+   words at a time. A span takes the reachable bits of the rows either side,
+   then floods each run of open cells they touch with shifts and ANDs, 64
+   cells to a word (256 with AVX2), carrying runs into further words as far
+   as they go. The words that changed become the spans to redo in the two
+   neighbouring rows. Rows with a span to redo are kept in a bitset and
+   swept down and up until none is left or the end turns up. */
+
+/* words [lo, hi) of a row; empty when lo >= hi */
+typedef struct wordSpan {
+    size_t lo, hi;
+} wordSpan;
+
+typedef void (*spanFillFn)(uint64_t *row, const uint64_t *above, const uint64_t *below,
+                           const uint64_t *walls, wordSpan todo, wordSpan *changed);
+
+typedef struct reachFill {
+    const uint64_t *walls;
+    uint64_t *reach;
+    wordSpan *todo;         /* per row */
+    uint64_t *dirty;        /* rows whose todo span is not empty */
+    size_t words;           /* per row */
+    int xsize;
+    spanFillFn fillSpan;
+} reachFill;
+
+static inline void spanAdd(wordSpan *span, size_t lo, size_t hi) {
+    if (lo >= hi) {
+        return;
+    }
+    if (span->lo >= span->hi) {
+        span->lo = lo;
+        span->hi = hi;
+        return;
+    }
+    span->lo = lo < span->lo ? lo : span->lo;
+    span->hi = hi > span->hi ? hi : span->hi;
+}
+
+/* every open bit of one word joined to seed by a run of open bits, in both directions */
+static inline uint64_t fillWord(uint64_t seed, uint64_t open) {
+    uint64_t up = seed, down = seed, upOpen = open, downOpen = open;
+    for (unsigned s = 1; s < 64; s <<= 1) {
+        up |= upOpen & (up << s);
+        upOpen &= upOpen << s;
+        down |= downOpen & (down >> s);
+        downOpen &= downOpen >> s;
+    }
+    return up | down;
+}
+
+/* Carry runs out of the changed words over word boundaries, rightwards then
+   leftwards; the rest of the row was already closed. */
+static void fillAcross(uint64_t *row, const uint64_t *walls, size_t words, wordSpan *changed) {
+    if (changed->lo >= changed->hi) {
+        return;
+    }
+    for (size_t w = changed->lo + 1; w < words && w <= changed->hi; w++) {
+        if ((row[w-1] >> 63) & ~walls[w] & ~row[w] & 1) {
+            row[w] = fillWord(row[w] | 1, ~walls[w]);
+            spanAdd(changed, w, w + 1);
+        }
+    }
+    for (size_t w = changed->hi - 1; w > 0 && w >= changed->lo; w--) {
+        if ((row[w] & 1) && ((~walls[w-1] & ~row[w-1]) >> 63)) {
+            row[w-1] = fillWord(row[w-1] | 1ULL << 63, ~walls[w-1]);
+            spanAdd(changed, w - 1, w);
+        }
+    }
+}
+
+static void fillSpanScalar(uint64_t *row, const uint64_t *above, const uint64_t *below,
+                           const uint64_t *walls, wordSpan todo, wordSpan *changed) {
+    for (size_t w = todo.lo; w < todo.hi; w++) {
+        uint64_t next = fillWord((row[w] | above[w] | below[w]) & ~walls[w], ~walls[w]);
+        if (next != row[w]) {
+            row[w] = next;
+            spanAdd(changed, w, w + 1);
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/* fillSpanScalar four words at a time */
+__attribute__((target("avx2")))
+static void fillSpanAVX2(uint64_t *row, const uint64_t *above, const uint64_t *below,
+                         const uint64_t *walls, wordSpan todo, wordSpan *changed) {
+    size_t w = todo.lo;
+
+    for (; w + 4 <= todo.hi; w += 4) {
+        __m256i old = _mm256_loadu_si256((const __m256i*)(row + w));
+        __m256i open = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i*)(walls + w)),
+                                           _mm256_set1_epi64x(-1));
+        __m256i seed = _mm256_or_si256(old, _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(above + w)),
+                                                            _mm256_loadu_si256((const __m256i*)(below + w))));
+        __m256i up = _mm256_and_si256(seed, open), down = up;
+        __m256i upOpen = open, downOpen = open;
+        for (int s = 1; s < 64; s <<= 1) {
+            up = _mm256_or_si256(up, _mm256_and_si256(upOpen, _mm256_slli_epi64(up, s)));
+            upOpen = _mm256_and_si256(upOpen, _mm256_slli_epi64(upOpen, s));
+            down = _mm256_or_si256(down, _mm256_and_si256(downOpen, _mm256_srli_epi64(down, s)));
+            downOpen = _mm256_and_si256(downOpen, _mm256_srli_epi64(downOpen, s));
+        }
+        __m256i next = _mm256_or_si256(up, down);
+        unsigned same = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(next, old)));
+        if (same != 0xF) {
+            _mm256_storeu_si256((__m256i*)(row + w), next);
+            unsigned lanes = ~same & 0xF;
+            spanAdd(changed, w + (size_t)__builtin_ctz(lanes), w + 32 - (size_t)__builtin_clz(lanes));
+        }
+    }
+    todo.lo = w;
+    fillSpanScalar(row, above, below, walls, todo, changed);
+}
+#endif
+
+static spanFillFn pickSpanFill(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return fillSpanAVX2;
+    }
+#endif
+    return fillSpanScalar;
+}
+
+/* first dirty row in [from, end), or end */
+static size_t nextDirtyRow(const uint64_t *dirty, size_t from, size_t end) {
+    if (from >= end) {
+        return end;
+    }
+    size_t w = from / 64;
+    uint64_t bits = dirty[w] & (~0ULL << (from % 64));
+    while (bits == 0) {
+        if (++w * 64 >= end) {
+            return end;
+        }
+        bits = dirty[w];
+    }
+    size_t x = w * 64 + (size_t)__builtin_ctzll(bits);
+    return x < end ? x : end;
+}
+
+/* last dirty row at or before from, or 0 (row 0 is never dirty) */
+static size_t prevDirtyRow(const uint64_t *dirty, size_t from) {
+    size_t w = from / 64;
+    uint64_t bits = dirty[w] & (~0ULL >> (63 - from % 64));
+    while (bits == 0) {
+        if (w == 0) {
+            return 0;
+        }
+        bits = dirty[--w];
+    }
+    return w * 64 + 63 - (size_t)__builtin_clzll(bits);
+}
+
+static void markRow(reachFill *rf, int x, wordSpan span) {
+    if (x >= 1 && x <= rf->xsize) {
+        spanAdd(&rf->todo[x], span.lo, span.hi);
+        rf->dirty[x / 64] |= 1ULL << (x % 64);
+    }
+}
+
+static void refillRow(reachFill *rf, size_t x) {
+    size_t words = rf->words;
+    wordSpan span = rf->todo[x], changed = { 0, 0 };
+
+    rf->todo[x].lo = rf->todo[x].hi = 0;
+    rf->dirty[x / 64] &= ~(1ULL << (x % 64));
+    rf->fillSpan(rf->reach + x * words, rf->reach + (x-1) * words, rf->reach + (x+1) * words,
+                 rf->walls + x * words, span, &changed);
+    fillAcross(rf->reach + x * words, rf->walls + x * words, words, &changed);
+    if (changed.lo < changed.hi) {
+        markRow(rf, (int)x - 1, changed);
+        markRow(rf, (int)x + 1, changed);
+    }
+}
+
+bool endReachable(const maze *m1) {
+    size_t rows = (size_t)m1->xsize + 2;
+    size_t words = rowWords(m1);
+    uint64_t *built;
+    reachFill rf;
+
+    rf.walls = wallBitmap(m1, &built);
+
+    rf.reach = (uint64_t*)calloc(rows * words, sizeof(uint64_t));
+    rf.todo = (wordSpan*)calloc(rows, sizeof(wordSpan));
+    rf.dirty = (uint64_t*)calloc((rows + 63) / 64, sizeof(uint64_t));
+    if (rf.walls == NULL || rf.reach == NULL || rf.todo == NULL || rf.dirty == NULL) {
+        /* not knowing, the end is left for the search to find or not */
+        fprintf(m1->out, "Unable to allocate the reachability bitmap.\n");
+        free(rf.reach);
+        free(rf.todo);
+        free(rf.dirty);
+        free(built);
+        return true;
+    }
+    countAlloc(sizeof(uint64_t) * rows * words + sizeof(wordSpan) * rows
+               + sizeof(uint64_t) * ((rows + 63) / 64));
+    rf.words = words;
+    rf.xsize = m1->xsize;
+    rf.fillSpan = pickSpanFill();
+
+    /* the start's own row and both neighbours need a look even if its run is just the start */
+    size_t startWord = (size_t)m1->ystart / 64;
+    wordSpan startSpan = { startWord, startWord + 1 };
+    rf.reach[(size_t)m1->xstart * words + startWord] = 1ULL << (m1->ystart % 64);
+    for (int x = m1->xstart - 1; x <= m1->xstart + 1; x++) {
+        markRow(&rf, x, startSpan);
+    }
+
+    const uint64_t *endWord = &rf.reach[(size_t)m1->xend * words + (size_t)m1->yend / 64];
+    uint64_t endBit = 1ULL << (m1->yend % 64);
+    size_t last = (size_t)m1->xsize;
+    size_t x = nextDirtyRow(rf.dirty, 1, last + 1);
+    while (x <= last && !(*endWord & endBit)) {
+        for (; x <= last; x = nextDirtyRow(rf.dirty, x + 1, last + 1)) {
+            refillRow(&rf, x);
+        }
+        for (x = prevDirtyRow(rf.dirty, last); x > 0; x = prevDirtyRow(rf.dirty, x - 1)) {
+            refillRow(&rf, x);
+        }
+        x = nextDirtyRow(rf.dirty, 1, last + 1);
+    }
+
+    bool found = (*endWord & endBit) != 0;
+    free(rf.reach);
+    free(rf.todo);
+    free(rf.dirty);
+    free(built);
+    return found;
+}
+
+// path output ================================================================
+
+void printReverse(stack* path) {
+    outBuf ob;
+    obInit(&ob, path->out);
+
+    /* the bottom of the stack is the start, so walk it from there up */
+    pathCursor c;
+    for (pathBegin(&c, path); c.at < path->numItems; pathNext(&c)) {
+        obPutc(&ob, '(');
+        obInt(&ob, c.cell.xpos);
+        obPutc(&ob, ',');
+        obInt(&ob, c.cell.ypos);
+        obWrite(&ob, ") ", 2);
+    }
+    obFlush(&ob);
+}
+
+/* The path as its first cell and then runs of moves, e.g. "(1,1) S12 E3 W4".
+   +x is south and +y is east, as the maze is drawn. */
+static void writeRunLengths(outBuf *ob, const stack *path) {
+    static const char compass[4] = { 'S', 'E', 'N', 'W' };
+
+    if (path->numItems == 0) {
+        return;
+    }
+    obPutc(ob, '(');
+    obInt(ob, path->first.xpos);
+    obPutc(ob, ',');
+    obInt(ob, path->first.ypos);
+    obPutc(ob, ')');
+    for (size_t i = 0; i + 1 < path->numItems; ) {
+        int dir = stepDir(path, i);
+        size_t run = 1;
+        while (i + run + 1 < path->numItems && stepDir(path, i + run) == dir) {
+            run++;
+        }
+        obPutc(ob, ' ');
+        obPutc(ob, compass[dir]);
+        obInt(ob, (long)run);
+        i += run;
+    }
+}
+
+void printRunLengths(stack* path) {
+    outBuf ob;
+    obInit(&ob, path->out);
+    writeRunLengths(&ob, path);
+    obFlush(&ob);
+}
+
+/* Run the selected search. Returns 1 and fills path if the end was
+   reached, 0 if not, or -1 if it ran out of memory (already reported). */
+int solveMaze(const maze *m1, stack *path, searchState *ss, runOptions *opts) {
+    /* the other solvers keep state per cell, which is what a sparse maze avoids */
+    if (m1->sparse) {
+        return findPathSparse(m1, path, opts->debugMode);
+    }
+    if (m1->disk) {
+        return findPathOutOfCore(m1, path);
+    }
+    if (opts->prefilter && !endReachable(m1)) {
+        return 0;
+    }
+    switch (opts->solver) {
+        case SOLVE_BFS :
+            return findPathBFS(m1, path, ss);
+        case SOLVE_ASTAR :
+            return findPathAStar(m1, path, ss);
+        case SOLVE_PARALLEL_BFS :
+            return findPathParallel(m1, path, ss, opts->workers);
+        case SOLVE_JPS :
+            return findPathJPS(m1, path, ss);
+        case SOLVE_BIDIRECTIONAL :
+            return findPathBidirectional(m1, path, ss, opts->debugMode);
+        case SOLVE_MAX_COINS :
+            return findPathCoins(m1, path, ss, opts->budget);
+        default :
+            return findPath(m1, path, ss, opts->debugMode);
+    }
+}
+
+/* false if the search ran out of memory */
+bool attemptEscape(maze *m1, runOptions *opts) {
+    stack path;
+    searchState ss;
+    bool debugMode = opts->debugMode;
+    int found;
+
+    init(&path);
+    path.out = m1->out;
+    searchInit(&ss);
+    double t0 = phaseStart(m1);
+    found = solveMaze(m1, &path, &ss, opts);
+    phaseEnd(m1, PHASE_SEARCH, t0);
+
+    if (m1->stats != NULL) {
+        runStats *stats = m1->stats;
+        stats->found = (found == 1);
+        stats->expanded = path.expanded;
+        stats->backtracks = path.pops;
+        stats->peakDepth = path.maxDepth;
+        stats->coinsDropped = (size_t)path.coinsDropped;
+        stats->coinsPicked = (size_t)(path.numCoins + path.coinsDropped);
+        stats->pathLength = found == 1 ? path.numItems : 0;
+    }
+
+    if (found == 1) {
+        fprintf(m1->out, "The maze has a solution.\n");
+        fprintf(m1->out, "The amount of coins collected: %d\n", path.numCoins);
+        /* the default depth-first search keeps the baseline's output */
+        if (opts->solver == SOLVE_BIDIRECTIONAL) {
+            fprintf(m1->out, "Nodes expanded: %zu (%zu from the start, %zu from the end)\n",
+                    path.expanded, path.expanded - path.expandedEnd, path.expandedEnd);
+        } else if (opts->solver != SOLVE_DFS) {
+            fprintf(m1->out, "Nodes expanded: %zu\n", path.expanded);
+        }
+        fprintf(m1->out, "The path from start to end: \n");
+        t0 = phaseStart(m1);
+        if (opts->runLengths) {
+            printRunLengths(&path);
+        } else {
+            printReverse(&path);
+        }
+        fprintf(m1->out, "\n");
+
+        if (opts->showPath) {
+            outBuf ob;
+            obInit(&ob, m1->out);
+            renderMaze(m1, &path, &ob);
+            obFlush(&ob);
+        }
+        phaseEnd(m1, PHASE_PATH_OUTPUT, t0);
+
+    } else if (found == 0) {
+        fprintf(m1->out, "This maze has no solution.\n");
+    }
+
+    clear(&path, debugMode);
+    searchFree(&ss);
+    return found >= 0;
+}
+
+void freeGrid(maze *m1) {
+    free(m1->arr);
+    if (m1->disk != NULL) {
+        tileCacheClose(m1->disk);
+        m1->disk = NULL;
+    }
+    free(m1->obstacles.cells);
+    memset(&m1->obstacles, 0, sizeof(m1->obstacles));
+    if (m1->mapBase != NULL) {
+        munmap(m1->mapBase, m1->mapLen);
+        m1->mapBase = NULL;
+    } else {
+        free(m1->walls);
+    }
+    m1->arr = NULL;
+    m1->walls = NULL;
+}
+
+void freeMaze(maze *m1) {
+    freeGrid(m1);
+    coinFree(&m1->coins);
+}
+
+// batch mode ================================================================
+
+/* One input of a batch. Its whole report is built in memory and written
+   with a single fwrite once every earlier job has been written. */
+typedef struct batchJob {
+    const char *fname;
+    char *report;
+    size_t reportLen;
+    int status;
+    bool done;
+    runStats stats;     /* for the -J report */
+} batchJob;
+
+/* Per-worker job queue. The owner takes from the head (the lowest job
+   numbers, so output keeps flowing in order); idle workers steal from the tail. */
+typedef struct jobDeque {
+    size_t *jobs;
+    size_t head, tail;
+    pthread_mutex_t lock;
+} jobDeque;
+
+typedef struct batchPool {
+    batchJob *jobs;
+    size_t numJobs;
+    jobDeque *deques;
+    int numWorkers;
+    runOptions *opts;
+    pthread_mutex_t doneLock;
+    pthread_cond_t doneCond;
+} batchPool;
+
+typedef struct batchWorker {
+    batchPool *pool;
+    int id;
+} batchWorker;
+
+static bool takeJob(jobDeque *dq, bool fromTail, size_t *job) {
+    bool found = false;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->head < dq->tail) {
+        *job = fromTail ? dq->jobs[--dq->tail] : dq->jobs[dq->head++];
+        found = true;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return found;
+}
+
+static void runJob(batchPool *pool, size_t n) {
+    batchJob *job = &pool->jobs[n];
+    FILE *out = open_memstream(&job->report, &job->reportLen);
+
+    if (out == NULL) {
+        job->status = -1;
+    } else {
+        fprintf(out, "==> %s <==\n", job->fname);
+        job->status = solveFile(job->fname, pool->opts, out, pool->opts->reportFile ? &job->stats : NULL);
+        if (job->status != 0) {
+            fprintf(out, "\n");
+        }
+        fclose(out);
+    }
+
+    pthread_mutex_lock(&pool->doneLock);
+    job->done = true;
+    pthread_cond_signal(&pool->doneCond);
+    pthread_mutex_unlock(&pool->doneLock);
+}
+
+static void *batchWorkerMain(void *arg) {
+    batchWorker *self = (batchWorker*)arg;
+    batchPool *pool = self->pool;
+    size_t n;
+
+    for (;;) {
+        if (takeJob(&pool->deques[self->id], false, &n)) {
+            runJob(pool, n);
+            continue;
+        }
+        /* own queue is empty: steal from the others, starting with the next worker */
+        bool stole = false;
+        for (int k = 1; k < pool->numWorkers && !stole; k++) {
+            int victim = (self->id + k) % pool->numWorkers;
+            stole = takeJob(&pool->deques[victim], true, &n);
+        }
+        if (!stole) {
+            break;
+        }
+        runJob(pool, n);
+    }
+    return NULL;
+}
+
+static int compareNames(const void *a, const void *b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* Add fname to the job list, or every regular file in it (sorted by name) if it is a directory. */
+static void addInputs(const char *fname, char ***names, size_t *count, size_t *size) {
+    struct stat st;
+    DIR *dir;
+
+    if (stat(fname, &st) != 0 || !S_ISDIR(st.st_mode) || (dir = opendir(fname)) == NULL) {
+        if (*count == *size) {
+            *size = *size ? *size * 2 : 16;
+            *names = (char**)realloc(*names, sizeof(char*) * *size);
+        }
+        (*names)[(*count)++] = strdup(fname);
+        return;
+    }
+
+    size_t first = *count;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        size_t len = strlen(fname) + strlen(ent->d_name) + 2;
+        char *path = (char*)malloc(len);
+        snprintf(path, len, "%s/%s", fname, ent->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(path);
+            continue;
+        }
+        if (*count == *size) {
+            *size = *size ? *size * 2 : 16;
+            *names = (char**)realloc(*names, sizeof(char*) * *size);
+        }
+        (*names)[(*count)++] = path;
+    }
+    closedir(dir);
+    qsort(*names + first, *count - first, sizeof(char*), compareNames);
+}
+
+/* Solve every input on a fixed pool of workers and print the reports in
+   input order. Returns the number of inputs that could not be solved. */
+int runBatch(char **inputs, int numInputs, runOptions *opts) {
+    char **names = NULL;
+    size_t numJobs = 0, size = 0;
+    batchPool pool;
+    int failed = 0;
+
+    for (int i = 0; i < numInputs; i++) {
+        addInputs(inputs[i], &names, &numJobs, &size);
+    }
+    if (numJobs == 0) {
+        return 0;
+    }
+
+    int workers = opts->workers;
+    if (workers < 1) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = online > 0 ? (int)online : 1;
+    }
+    if ((size_t)workers > numJobs) {
+        workers = (int)numJobs;
+    }
+
+    pool.jobs = (batchJob*)calloc(numJobs, sizeof(batchJob));
+    pool.numJobs = numJobs;
+    pool.deques = (jobDeque*)calloc((size_t)workers, sizeof(jobDeque));
+    pool.numWorkers = workers;
+    pool.opts = opts;
+    pthread_mutex_init(&pool.doneLock, NULL);
+    pthread_cond_init(&pool.doneCond, NULL);
+
+    /* deal the jobs out round-robin so every worker starts near the front of the output */
+    for (int w = 0; w < workers; w++) {
+        pool.deques[w].jobs = (size_t*)malloc(sizeof(size_t) * (numJobs / (size_t)workers + 1));
+        pthread_mutex_init(&pool.deques[w].lock, NULL);
+    }
+    for (size_t n = 0; n < numJobs; n++) {
+        jobDeque *dq = &pool.deques[n % (size_t)workers];
+        pool.jobs[n].fname = names[n];
+        dq->jobs[dq->tail++] = n;
+    }
+
+    pthread_t *threads = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)workers);
+    batchWorker *self = (batchWorker*)malloc(sizeof(batchWorker) * (size_t)workers);
+    for (int w = 0; w < workers; w++) {
+        self[w].pool = &pool;
+        self[w].id = w;
+        pthread_create(&threads[w], NULL, batchWorkerMain, &self[w]);
+    }
+
+    /* write each report as soon as it and everything before it is finished */
+    for (size_t n = 0; n < numJobs; n++) {
+        pthread_mutex_lock(&pool.doneLock);
+        while (!pool.jobs[n].done) {
+            pthread_cond_wait(&pool.doneCond, &pool.doneLock);
+        }
+        pthread_mutex_unlock(&pool.doneLock);
+
+        if (pool.jobs[n].report != NULL) {
+            fwrite(pool.jobs[n].report, 1, pool.jobs[n].reportLen, stdout);
+            fflush(stdout);
+            free(pool.jobs[n].report);
+        }
+        if (pool.jobs[n].status != 0) {
+            failed++;
+        }
+    }
+
+    /* -J: one array holding the report of every file that was solved */
+    if (opts->reportFile != NULL) {
+        FILE *report = strcmp(opts->reportFile, "-") == 0 ? stdout : fopen(opts->reportFile, "w");
+        bool ok = (report != NULL);
+        if (ok) {
+            const char *sep = "";
+            fprintf(report, "[\n");
+            for (size_t n = 0; n < numJobs && ok; n++) {
+                if (pool.jobs[n].status == 0) {
+                    fputs(sep, report);
+                    ok = writeRunReport(report, names[n], opts, &pool.jobs[n].stats);
+                    sep = ",\n";
+                }
+            }
+            fprintf(report, "]\n");
+            ok = !ferror(report) && ok;
+            if (report != stdout) {
+                ok = (fclose(report) == 0) && ok;
+            }
+        }
+        if (!ok) {
+            printf("Can't write report file: %s\n", opts->reportFile);
+        }
+    }
+
+    for (int w = 0; w < workers; w++) {
+        pthread_join(threads[w], NULL);
+        pthread_mutex_destroy(&pool.deques[w].lock);
+        free(pool.deques[w].jobs);
+    }
+    pthread_mutex_destroy(&pool.doneLock);
+    pthread_cond_destroy(&pool.doneCond);
+    for (size_t n = 0; n < numJobs; n++) {
+        free(names[n]);
+    }
+    free(names);
+    free(threads);
+    free(self);
+    free(pool.deques);
+    free(pool.jobs);
+    return failed;
+}
+
+// benchmark mode ============================================================
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double perSecond(double count, double seconds) {
+    return seconds > 0 ? count / seconds : 0;
+}
+
+/* Time each phase of a run separately for every input: mapping the file and
+   reading the header, createMaze, the selected solver, and outputMaze (into
+   /dev/null), then the bit-parallel reachability check on its own. Reports go to /dev/null; one table row per file goes to stdout.
+   Returns the number of inputs that could not be benchmarked. */
+int runBench(char **inputs, int numInputs, runOptions *opts) {
+    static const char* solverName[] = { "dfs", "bfs", "astar", "parallel", "jps", "bidir", "coins" };
+    FILE *devNull = fopen("/dev/null", "w");
+    int failed = 0;
+
+    if (devNull == NULL) {
+        printf("Can't open /dev/null\n");
+        return numInputs;
+    }
+
+    printf("%-32s %-8s %-6s %12s %10s %9s %9s %9s %9s %12s %12s %12s %12s %9s\n",
+           "file", "solver", "layout", "cells", "obstacles", "load_s", "create_s", "solve_s", "render_s",
+           "create_c/s", "obst/s", "solve_c/s", "render_c/s", "reach_s");
+
+    for (int i = 0; i < numInputs; i++) {
+        mazeSource src;
+        maze m1;
+        stack path;
+
+        memset(&m1, 0, sizeof(m1));
+        m1.packed = opts->packed;
+        m1.tiled = opts->tiled;
+        m1.sparse = opts->sparse;
+        m1.tileFile = opts->tileFile;
+        m1.cacheBytes = opts->cacheBytes;
+        m1.out = devNull;
+
+        double t0 = nowSeconds();
+        if (!openSource(inputs[i], &src)) {
+            printf("%-32s could not be opened\n", inputs[i]);
+            failed++;
+            continue;
+        }
+        size_t obstacles = 0;
+        double t1, t2;
+        if (isBinaryMaze(&src) && (m1.sparse || m1.tileFile != NULL)) {
+            printf("%-32s is a binary maze, which can't be loaded %s\n", inputs[i],
+                   m1.sparse ? "sparse (-z)" : "into tiles on disk (-D)");
+            closeSource(&src);
+            failed++;
+            continue;
+        } else if (isBinaryMaze(&src)) {
+            /* nothing to create: the load is the whole setup */
+            bool loaded = loadBinaryMaze(&src, &m1);
+            t1 = t2 = nowSeconds();
+            closeSource(&src);
+            if (!loaded) {
+                printf("%-32s is not a valid binary maze\n", inputs[i]);
+                failed++;
+                continue;
+            }
+            obstacles = m1.coins.count;
+        } else if (!checkFile(&src, &m1)) {
+            printf("%-32s is not a maze file\n", inputs[i]);
+            closeSource(&src);
+            failed++;
+            continue;
+        } else {
+            t1 = nowSeconds();
+            if (!prepMaze(&m1)) {
+                printf("%-32s has an invalid header\n", inputs[i]);
+                closeSource(&src);
+                failed++;
+                continue;
+            }
+            obstacles = fillMaze(&src, &m1);
+            t2 = nowSeconds();
+            closeSource(&src);
+        }
+
+        outBuf ob;
+        obInit(&ob, devNull);
+        renderMaze(&m1, NULL, &ob);
+        obFlush(&ob);
+        fflush(devNull);
+        double t3 = nowSeconds();
+
+        searchState ss;
+        searchInit(&ss);
+        init(&path);
+        path.out = devNull;
+        int found = solveMaze(&m1, &path, &ss, opts);
+        double t4 = nowSeconds();
+        clear(&path, false);
+        searchFree(&ss);
+        if (found < 0) {
+            printf("%-32s ran out of memory in the search\n", inputs[i]);
+            freeMaze(&m1);
+            failed++;
+            continue;
+        }
+        if (!m1.sparse && m1.disk == NULL) {
+            endReachable(&m1);
+        }
+        double t5 = nowSeconds();
+
+        double cells = (double)(m1.xsize+2) * (double)(m1.ysize+2);
+        printf("%-32s %-8s %-6s %12.0f %10zu %9.4f %9.4f %9.4f %9.4f %12.4g %12.4g %12.4g %12.4g %9.4f\n",
+               inputs[i], m1.sparse ? "sparse" : m1.disk ? "disk" : solverName[opts->solver],
+               m1.sparse ? "sparse" : m1.disk ? "disk" : m1.walls != NULL ? "packed" : m1.tiled ? "tiled" : "rows",
+               cells, obstacles,
+               t1 - t0, t2 - t1, t4 - t3, t3 - t2,
+               perSecond(cells, t2 - t1), perSecond((double)obstacles, t2 - t1),
+               perSecond(cells, t4 - t3), perSecond(cells, t3 - t2), t5 - t4);
+        fflush(stdout);
+        freeMaze(&m1);
+    }
+
+    fclose(devNull);
+    return failed;
+}
+
+// binary maze files =========================================================
+
+/* four independent multiply-xorshift lanes so the scan is not one long dependency chain */
+static uint64_t mazeChecksum(const uint64_t *words, size_t n) {
+    const uint64_t k = 0xFF51AFD7ED558CCDULL;
+    uint64_t h[4] = { 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL,
+                      0x165667B19E3779F9ULL, 0x27D4EB2F165667C5ULL };
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            h[lane] = (h[lane] ^ words[i + lane]) * k;
+            h[lane] ^= h[lane] >> 32;
+        }
+    }
+    for (; i < n; i++) {
+        h[0] = (h[0] ^ words[i]) * k;
+        h[0] ^= h[0] >> 32;
+    }
+    return (h[0] ^ (h[1] * 3) ^ (h[2] * 5) ^ (h[3] * 7)) + n;
+}
+
+bool isBinaryMaze(const mazeSource *src) {
+    return src->len >= sizeof(mazeFileHeader) && memcmp(src->data, MAZE_FILE_MAGIC, 4) == 0;
+}
+
+/* The checksum only catches damage, not a file written to be hostile. The
+   searches step off any open cell without a bounds check, trusting the
+   border to be solid wall, so check that it is, that the start and end are
+   open, and that every coin lies inside the maze. */
+static bool binaryMazeSound(const maze *m1, const uint64_t *coins, size_t numCoins) {
+    size_t stride = m1->stride;
+    size_t lastRow = (size_t)m1->xsize + 1, lastCol = (size_t)m1->ysize + 1;
+
+    for (size_t y = 0; y <= lastCol; y++) {
+        if (!wallBit(m1, y) || !wallBit(m1, lastRow * stride + y)) {
+            return false;
+        }
+    }
+    for (size_t x = 1; x < lastRow; x++) {
+        if (!wallBit(m1, x * stride) || !wallBit(m1, x * stride + lastCol)) {
+            return false;
+        }
+    }
+    if (wallBit(m1, (size_t)m1->xstart * stride + (size_t)m1->ystart)
+        || wallBit(m1, (size_t)m1->xend * stride + (size_t)m1->yend)) {
+        return false;
+    }
+    for (size_t n = 0; n < numCoins; n++) {
+        if (coins[n] >= lastRow * stride || coins[n] / stride == 0
+            || coins[n] % stride == 0 || coins[n] % stride >= lastCol) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Check the header and checksum and point a packed maze at the mapped
+   bitmap. The maze takes over the mapping; only the coin list is copied. */
+bool loadBinaryMaze(mazeSource *src, maze *m1) {
+    const mazeFileHeader *hdr = (const mazeFileHeader*)src->data;
+
+    if (hdr->version != MAZE_FILE_VERSION || hdr->xsize < 1 || hdr->ysize < 1
+        || hdr->xsize > MAZE_MAX_SIDE || hdr->ysize > MAZE_MAX_SIDE
+        || hdr->stride != (((uint64_t)hdr->ysize + 2 + 63) & ~(uint64_t)63)
+        || hdr->wallWords != ((uint64_t)hdr->xsize + 2) * hdr->stride / 64
+        || hdr->numCoins > (src->len - sizeof(mazeFileHeader)) / sizeof(uint64_t)
+        || src->len != sizeof(mazeFileHeader) + (hdr->wallWords + hdr->numCoins) * sizeof(uint64_t)) {
+        return false;
+    }
+
+    const uint64_t *words = (const uint64_t*)(src->data + sizeof(mazeFileHeader));
+    if (mazeChecksum(words, (size_t)(hdr->wallWords + hdr->numCoins)) != hdr->checksum) {
+        return false;
+    }
+
+    m1->xsize = hdr->xsize;
+    m1->ysize = hdr->ysize;
+    m1->xstart = hdr->xstart;
+    m1->ystart = hdr->ystart;
+    m1->xend = hdr->xend;
+    m1->yend = hdr->yend;
+    if (m1->xstart < 1 || m1->xstart > m1->xsize || m1->ystart < 1 || m1->ystart > m1->ysize
+        || m1->xend < 1 || m1->xend > m1->xsize || m1->yend < 1 || m1->yend > m1->ysize) {
+        return false;
+    }
+    fprintf (m1->out, "size: %d, %d\n", m1->xsize, m1->ysize);
+    fprintf (m1->out, "start: %d, %d\n", m1->xstart, m1->ystart);
+    fprintf (m1->out, "end: %d, %d\n", m1->xend, m1->yend);
+
+    /* the bitmap is used in place, so it keeps the file's row-major layout whatever -t asked for */
+    m1->packed = true;
+    m1->tiled = false;
+    m1->arr = NULL;
+    m1->stride = (size_t)hdr->stride;
+    m1->walls = (uint64_t*)words;
+    if (!binaryMazeSound(m1, words + hdr->wallWords, (size_t)hdr->numCoins)) {
+        m1->walls = NULL;
+        return false;
+    }
+    memset(&m1->coins, 0, sizeof(m1->coins));
+    for (uint64_t n = 0; n < hdr->numCoins; n++) {
+        coinAdd(&m1->coins, (size_t)words[hdr->wallWords + n]);
+    }
+
+    m1->mapBase = (void*)src->data;
+    m1->mapLen = src->len;
+    src->data = src->pos = src->end = NULL;
+    src->len = 0;
+    return true;
+}
+
+bool writeBinaryMaze(maze *m1, const char *fname) {
+    mazeFileHeader hdr;
+    size_t wallWords = numCells(m1) / 64;
+    uint64_t *words = (uint64_t*)malloc(sizeof(uint64_t) * (wallWords + m1->coins.count));
+    size_t numCoins = 0;
+    FILE *out;
+
+    if (words == NULL) {
+        return false;
+    }
+    memcpy(words, m1->walls, sizeof(uint64_t) * wallWords);
+    for (size_t i = 0; m1->coins.keys != NULL && i <= m1->coins.mask; i++) {
+        if (m1->coins.keys[i] != 0) {
+            words[wallWords + numCoins++] = m1->coins.keys[i] - 1;
+        }
+    }
+    qsort(words + wallWords, numCoins, sizeof(uint64_t), compareIndex);
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MAZE_FILE_MAGIC, 4);
+    hdr.version = MAZE_FILE_VERSION;
+    hdr.xsize = m1->xsize;
+    hdr.ysize = m1->ysize;
+    hdr.xstart = m1->xstart;
+    hdr.ystart = m1->ystart;
+    hdr.xend = m1->xend;
+    hdr.yend = m1->yend;
+    hdr.stride = m1->stride;
+    hdr.wallWords = wallWords;
+    hdr.numCoins = numCoins;
+    hdr.checksum = mazeChecksum(words, wallWords + numCoins);
+
+    bool ok = (out = fopen(fname, "wb")) != NULL
+              && fwrite(&hdr, sizeof(hdr), 1, out) == 1
+              && fwrite(words, sizeof(uint64_t), wallWords + numCoins, out) == wallWords + numCoins;
+    if (out != NULL && fclose(out) != 0) {
+        ok = false;
+    }
+    free(words);
+    return ok;
+}
+
+/* read a text maze into the packed form and save it as a binary maze file */
+int convertFile(const char *fname, const char *outName) {
+    maze m1;
+    mazeSource src;
+
+    if (!openSource(fname, &src)) {
+        printf ( "Can't open input file: %s", fname );
+        return -1;
+    }
+    memset(&m1, 0, sizeof(m1));
+    m1.packed = true;
+    m1.out = stdout;
+    if (!checkFile(&src, &m1)) {
+        printf("Invalid data file\n");
+        closeSource(&src);
+        return -1;
+    }
+    bool created = createMaze(&src, &m1);
+    closeSource(&src);
+    if (!created) {
+        return -1;
+    }
+
+    bool written = writeBinaryMaze(&m1, outName);
+    if (written) {
+        printf("Wrote %s (%zu coins)\n", outName, m1.coins.count);
+    } else {
+        printf("Can't write binary maze file: %s\n", outName);
+    }
+    freeMaze(&m1);
+    return written ? 0 : -1;
+}
+
+// multi-query mode ==========================================================
+
+/* Queries are read and answered in chunks. Within a chunk they are grouped
+   by start cell, so one distance field serves every query from that start;
+   the answers are then written in file order. */
+#define QUERY_CHUNK 65536
+
+typedef struct mazeQuery {
+    int xstart, ystart, xend, yend;
+    size_t startIdx;
+    long steps;                 /* -1 when there is no path */
+    stack path;                 /* kept for output with -p */
+} mazeQuery;
+
+typedef struct queryRun {
+    const maze *m1;
+    uint32_t *label;            /* connected component of each open cell; 0 for walls */
+    uint32_t *dist;             /* steps from the current field's start, valid where visited */
+    uint8_t *wanted;            /* end cells the current field still has to reach */
+    searchState ss;
+    cellQueue q;
+    stack scratch;              /* A* paths that are only counted */
+    bool listPaths, runLengths;
+    size_t fields, unreachable;
+} queryRun;
+
+/* Label every open cell with its 4-connected component, one flood fill per component. */
+static bool labelComponents(queryRun *qr, uint32_t *numLabels) {
+    const maze *m1 = qr->m1;
+    uint32_t next = 0;
+
+    qr->label = (uint32_t*)calloc(numCells(m1), sizeof(uint32_t));
+    if (qr->label == NULL) {
+        return false;
+    }
+    for (int x = 1; x <= m1->xsize; x++) {
+        for (int y = 1; y <= m1->ysize; y++) {
+            size_t idx = cellIndex(m1, x, y);
+            if (qr->label[idx] != 0 || isWall(m1, idx)) {
+                continue;
+            }
+            qr->label[idx] = ++next;
+            queuePush(&qr->q, idx);
+            while (qr->q.count > 0 && !qr->q.failed) {
+                size_t cur = queuePop(&qr->q);
+                unsigned open = openDirs(m1, cellRow(m1, cur), cellCol(m1, cur));
+                for (int dir = 0; dir < 4; dir++) {
+                    size_t nb = stepCell(m1, cur, dir);
+                    if ((open >> dir & 1) && qr->label[nb] == 0) {
+                        qr->label[nb] = next;
+                        queuePush(&qr->q, nb);
+                    }
+                }
+            }
+        }
+    }
+    *numLabels = next;
+    return !qr->q.failed;
+}
+
+/* Breadth-first from startIdx, recording the distance and parent direction
+   of every cell reached, until the remaining wanted cells have all been reached. */
+static void distanceField(queryRun *qr, size_t startIdx, size_t remaining) {
+    const maze *m1 = qr->m1;
+
+    if (!searchBegin(&qr->ss, m1)) {
+        fprintf(stderr, "Unable to allocate the search state.\n");
+        exit(-1);
+    }
+    markVisited(&qr->ss, startIdx);
+    qr->dist[startIdx] = 0;
+    if (qr->wanted[startIdx]) {
+        qr->wanted[startIdx] = 0;
+        remaining--;
+    }
+    queuePush(&qr->q, startIdx);
+    while (qr->q.count > 0 && remaining > 0) {
+        size_t idx = queuePop(&qr->q);
+        unsigned open = openDirs(m1, cellRow(m1, idx), cellCol(m1, idx));
+        for (int dir = 0; dir < 4; dir++) {
+            size_t next = stepCell(m1, idx, dir);
+            if (!(open >> dir & 1) || isVisited(&qr->ss, next)) {
+                continue;
+            }
+            markVisited(&qr->ss, next);
+            setParentDir(qr->ss.parent, next, dir);
+            qr->dist[next] = qr->dist[idx] + 1;
+            queuePush(&qr->q, next);
+            if (qr->wanted[next]) {
+                qr->wanted[next] = 0;
+                remaining--;
+            }
+        }
+    }
+    if (qr->q.failed) {
+        fprintf(stderr, "Unable to grow the search queue.\n");
+        exit(-1);
+    }
+    qr->q.head = qr->q.count = 0;
+    qr->fields++;
+}
+
+static bool openCell(const maze *m1, int x, int y) {
+    return x >= 1 && x <= m1->xsize && y >= 1 && y <= m1->ysize && !isWall(m1, cellIndex(m1, x, y));
+}
+
+/* Answer group[0..n), which all share a start cell. A lone reachable query
+   is solved with A*; two or more share one distance field. */
+static void answerGroup(queryRun *qr, mazeQuery **group, size_t n) {
+    const maze *m1 = qr->m1;
+    size_t reachable = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        mazeQuery *qu = group[i];
+        qu->steps = -1;
+        qu->path.numItems = 0;
+        if (openCell(m1, qu->xstart, qu->ystart) && openCell(m1, qu->xend, qu->yend)
+            && qr->label[qu->startIdx] == qr->label[cellIndex(m1, qu->xend, qu->yend)]) {
+            qu->steps = 0;
+            reachable++;
+        } else {
+            qr->unreachable++;
+        }
+    }
+    if (reachable > 1) {
+        size_t targets = 0;
+        for (size_t i = 0; i < n; i++) {
+            size_t endIdx = cellIndex(m1, group[i]->xend, group[i]->yend);
+            if (group[i]->steps == 0 && !qr->wanted[endIdx]) {
+                qr->wanted[endIdx] = 1;
+                targets++;
+            }
+        }
+        distanceField(qr, group[0]->startIdx, targets);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        mazeQuery *qu = group[i];
+        if (qu->steps < 0) {
+            continue;
+        }
+        /* the same maze, asked about this query's endpoints */
+        maze qm = *m1;
+        qm.xstart = qu->xstart;
+        qm.ystart = qu->ystart;
+        qm.xend = qu->xend;
+        qm.yend = qu->yend;
+        stack *path = qr->listPaths ? &qu->path : &qr->scratch;
+        path->numItems = 0;
+
+        /* -Q answers a single maze, so there is no batch to keep going */
+        if (reachable == 1) {
+            if (findPathAStar(&qm, path, &qr->ss) < 0) {
+                exit(-1);
+            }
+            qu->steps = (long)path->numItems - 1;
+        } else {
+            qu->steps = (long)qr->dist[cellIndex(m1, qu->xend, qu->yend)];
+            if (qr->listPaths && !buildPath(&qm, qr->ss.parent, path)) {
+                fprintf(stderr, "Unable to allocate the path stack.\n");
+                exit(-1);
+            }
+        }
+    }
+}
+
+static int compareQueryStarts(const void *a, const void *b) {
+    const mazeQuery *qa = *(const mazeQuery* const*)a;
+    const mazeQuery *qb = *(const mazeQuery* const*)b;
+    if (qa->startIdx != qb->startIdx) {
+        return (qa->startIdx > qb->startIdx) - (qa->startIdx < qb->startIdx);
+    }
+    return (qa > qb) - (qa < qb);
+}
+
+/* Read up to QUERY_CHUNK "x1 y1 x2 y2" lines; returns how many were read. */
+static size_t readQueries(mazeSource *src, const maze *m1, mazeQuery *qs, size_t *malformed) {
+    const char* p = src->pos;
+    const char* end = src->end;
+    size_t n = 0;
+
+    while (p < end && n < QUERY_CHUNK) {
+        const char* line = skipBlanks(p, end);
+        if (line == end || *line == '\n') {
+            p = line + (line < end);
+            continue;
+        }
+        long v[4];
+        p = line;
+        if (!scanInt(&p, end, &v[0]) || !scanInt(&p, end, &v[1])
+            || !scanInt(&p, end, &v[2]) || !scanInt(&p, end, &v[3])) {
+            (*malformed)++;
+            p = nextLine(line, end);
+            continue;
+        }
+        p = nextLine(p, end);
+
+        mazeQuery *qu = &qs[n++];
+        qu->xstart = clampCoord(v[0]);
+        qu->ystart = clampCoord(v[1]);
+        qu->xend = clampCoord(v[2]);
+        qu->yend = clampCoord(v[3]);
+        qu->startIdx = openCell(m1, qu->xstart, qu->ystart) ? cellIndex(m1, qu->xstart, qu->ystart) : 0;
+    }
+    src->pos = p;
+    return n;
+}
+
+/* Load one maze and answer every query in opts->queryFile against it. Each
+   answer is a line "x1 y1 x2 y2 steps" (steps is -1 when there is no
+   path), followed by the path cells with -w, or its runs of moves with
+   -w -r. The solver flags are ignored. */
+int runQueries(const char *fname, runOptions *opts) {
+    maze m1;
+    queryRun qr;
+    mazeSource src;
+    mazeQuery *qs = (mazeQuery*)malloc(sizeof(mazeQuery) * QUERY_CHUNK);
+    mazeQuery **order = (mazeQuery**)malloc(sizeof(mazeQuery*) * QUERY_CHUNK);
+    size_t malformed = 0, total = 0;
+    uint32_t components = 0;
+
+    memset(&m1, 0, sizeof(m1));
+    m1.packed = opts->packed;
+    m1.tiled = opts->tiled;
+    m1.out = stderr;
+    if (qs == NULL || order == NULL || !loadMaze(fname, &m1)) {
+        free(qs);
+        free(order);
+        return -1;
+    }
+    if (!openSource(opts->queryFile, &src)) {
+        fprintf(stderr, "Can't open query file: %s\n", opts->queryFile);
+        freeMaze(&m1);
+        free(qs);
+        free(order);
+        return -1;
+    }
+
+    memset(&qr, 0, sizeof(qr));
+    qr.m1 = &m1;
+    qr.listPaths = opts->queryPaths;
+    qr.runLengths = opts->runLengths;
+    searchInit(&qr.ss);
+    init(&qr.scratch);
+    for (size_t i = 0; i < QUERY_CHUNK; i++) {
+        init(&qs[i].path);
+    }
+    bool queued = queueInit(&qr.q, 2 * ((size_t)m1.xsize + m1.ysize + 4));
+    qr.dist = (uint32_t*)malloc(sizeof(uint32_t) * numCells(&m1));
+    qr.wanted = (uint8_t*)calloc(numCells(&m1), 1);
+    if (!queued || qr.dist == NULL || qr.wanted == NULL || !labelComponents(&qr, &components)) {
+        fprintf(stderr, "Unable to allocate the query state.\n");
+        closeSource(&src);
+        free(qr.q.items);
+        free(qr.label);
+        free(qr.dist);
+        free(qr.wanted);
+        free(qs);
+        free(order);
+        freeMaze(&m1);
+        return -1;
+    }
+
+    outBuf ob;
+    obInit(&ob, stdout);
+    for (;;) {
+        size_t n = readQueries(&src, &m1, qs, &malformed);
+        if (n == 0) {
+            break;
+        }
+        total += n;
+        for (size_t i = 0; i < n; i++) {
+            order[i] = &qs[i];
+        }
+        qsort(order, n, sizeof(mazeQuery*), compareQueryStarts);
+        for (size_t i = 0, j; i < n; i = j) {
+            for (j = i + 1; j < n && order[j]->startIdx == order[i]->startIdx; j++) {
+            }
+            answerGroup(&qr, order + i, j - i);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            const mazeQuery *qu = &qs[i];
+            obInt(&ob, qu->xstart);
+            obPutc(&ob, ' ');
+            obInt(&ob, qu->ystart);
+            obPutc(&ob, ' ');
+            obInt(&ob, qu->xend);
+            obPutc(&ob, ' ');
+            obInt(&ob, qu->yend);
+            obPutc(&ob, ' ');
+            obInt(&ob, qu->steps);
+            if (qr.runLengths && qu->path.numItems > 0) {
+                obPutc(&ob, ' ');
+                writeRunLengths(&ob, &qu->path);
+            } else {
+                pathCursor c;
+                for (pathBegin(&c, &qu->path); c.at < qu->path.numItems; pathNext(&c)) {
+                    obWrite(&ob, " (", 2);
+                    obInt(&ob, c.cell.xpos);
+                    obPutc(&ob, ',');
+                    obInt(&ob, c.cell.ypos);
+                    obPutc(&ob, ')');
+                }
+            }
+            obPutc(&ob, '\n');
+        }
+        obFlush(&ob);
+    }
+
+    if (malformed > 0) {
+        fprintf(stderr, "Invalid line: expected <x1> <y1> <x2> <y2>. (%zu %s)\n",
+                malformed, malformed == 1 ? "line" : "lines");
+    }
+    fprintf(stderr, "%zu queries, %zu unreachable, %u components, %zu distance fields\n",
+            total, qr.unreachable, components, qr.fields);
+
+    closeSource(&src);
+    clear(&qr.scratch, false);
+    for (size_t i = 0; i < QUERY_CHUNK; i++) {
+        clear(&qs[i].path, false);
+    }
+    searchFree(&qr.ss);
+    free(qr.q.items);
+    free(qr.label);
+    free(qr.dist);
+    free(qr.wanted);
+    free(qs);
+    free(order);
+    freeMaze(&m1);
+    return 0;
+}
+
+// server mode ===============================================================
+
+/* Mazes stay loaded while clients send requests over a Unix socket. A
+   message in either direction is a 4-byte length in network byte order
+   followed by that many bytes of text. Requests are
+       solve <maze> <x1> <y1> <x2> <y2> [dfs|bfs|astar|jps|bidir] [path]
+       info <maze>
+   and replies start with "ok", "none" (no path) or "error". A maze is
+   named by its file name without directory or extension. One thread polls
+   the listening socket and every idle connection; when a request arrives
+   its connection is queued for the workers, and whichever takes it answers
+   that one request and hands the connection back to be polled again. Idle
+   clients therefore hold no worker, and a client that stops halfway through
+   a message holds one for at most SERVER_IO_TIMEOUT seconds. */
+#define SERVER_MAX_REQUEST 4096
+#define SERVER_BACKLOG 128
+#define SERVER_IO_TIMEOUT 5
+
+typedef struct residentMaze {
+    char name[64];
+    maze m1;
+} residentMaze;
+
+typedef struct mazeServer {
+    residentMaze *mazes;
+    int numMazes;
+    int listenFd;
+    int handBack[2];        /* pipe: workers write served connections back to the poller */
+    int *ready;             /* ring of connections with a request waiting */
+    size_t readyHead, readyCount, readySize;
+    pthread_mutex_t readyLock;
+    pthread_cond_t readyCond;
+} mazeServer;
+
+/* a reply under construction; the first 4 bytes are kept for the length */
+typedef struct replyBuf {
+    char *data;
+    size_t len, size;
+} replyBuf;
+
+static void replyPrintf(replyBuf *r, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(r->data + r->len, r->size - r->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            return;
+        }
+        if ((size_t)n < r->size - r->len) {
+            r->len += (size_t)n;
+            return;
+        }
+        size_t newSize = r->size * 2 + (size_t)n;
+        char *data = (char*)realloc(r->data, newSize);
+        if (data == NULL) {
+            fprintf(stderr, "Unable to grow a reply past %zu bytes.\n", r->size);
+            exit(-1);
+        }
+        r->data = data;
+        r->size = newSize;
+    }
+}
+
+static bool readFull(int fd, void *buf, size_t n) {
+    char *p = (char*)buf;
+    while (n > 0) {
+        ssize_t got = read(fd, p, n);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        p += got;
+        n -= (size_t)got;
+    }
+    return true;
+}
+
+static bool writeFull(int fd, const void *buf, size_t n) {
+    const char *p = (const char*)buf;
+    while (n > 0) {
+        ssize_t put = send(fd, p, n, MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR) {
+            continue;
+        }
+        if (put <= 0) {
+            return false;
+        }
+        p += put;
+        n -= (size_t)put;
+    }
+    return true;
+}
+
+static const residentMaze *findResident(const mazeServer *srv, const char *name) {
+    for (int i = 0; i < srv->numMazes; i++) {
+        if (strcmp(srv->mazes[i].name, name) == 0) {
+            return &srv->mazes[i];
+        }
+    }
+    return NULL;
+}
+
+/* Answer one request into r. Each worker brings its own search state and
+   path stack, so the resident mazes are only ever read. */
+static void handleRequest(const mazeServer *srv, char *req, searchState *ss, stack *path, replyBuf *r) {
+    char cmd[16], name[64], algo[16] = "dfs", extra[16] = "";
+    int x1, y1, x2, y2;
+    int fields = sscanf(req, "%15s %63s %d %d %d %d %15s %15s", cmd, name, &x1, &y1, &x2, &y2, algo, extra);
+
+    const residentMaze *rm = fields >= 2 ? findResident(srv, name) : NULL;
+    if (fields >= 2 && rm == NULL) {
+        replyPrintf(r, "error unknown maze %s", name);
+        return;
+    }
+    if (fields == 2 && strcmp(cmd, "info") == 0) {
+        const maze *m1 = &rm->m1;
+        replyPrintf(r, "ok %d %d %d %d %d %d", m1->xsize, m1->ysize, m1->xstart, m1->ystart, m1->xend, m1->yend);
+        return;
+    }
+    if (fields < 6 || strcmp(cmd, "solve") != 0) {
+        replyPrintf(r, "error expected: solve <maze> <x1> <y1> <x2> <y2> [dfs|bfs|astar|jps|bidir] [path]");
+        return;
+    }
+
+    runOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    if (strcmp(algo, "path") == 0) {
+        strcpy(algo, "dfs");
+        strcpy(extra, "path");
+    }
+    if (strcmp(algo, "bfs") == 0) {
+        opts.solver = SOLVE_BFS;
+    } else if (strcmp(algo, "astar") == 0) {
+        opts.solver = SOLVE_ASTAR;
+    } else if (strcmp(algo, "jps") == 0) {
+        opts.solver = SOLVE_JPS;
+    } else if (strcmp(algo, "bidir") == 0) {
+        opts.solver = SOLVE_BIDIRECTIONAL;
+    } else if (strcmp(algo, "dfs") != 0) {
+        replyPrintf(r, "error unknown algorithm %s", algo);
+        return;
+    }
+    if (!openCell(&rm->m1, x1, y1) || !openCell(&rm->m1, x2, y2)) {
+        replyPrintf(r, "error endpoints must be open cells inside the maze");
+        return;
+    }
+
+    /* the same maze, asked about this request's endpoints */
+    maze qm = rm->m1;
+    qm.xstart = x1;
+    qm.ystart = y1;
+    qm.xend = x2;
+    qm.yend = y2;
+    qm.out = stderr;
+    path->numItems = 0;
+    path->numCoins = 0;
+    path->expanded = 0;
+    int found = solveMaze(&qm, path, ss, &opts);
+    if (found < 0) {
+        replyPrintf(r, "error out of memory");
+        return;
+    }
+    if (found == 0) {
+        replyPrintf(r, "none %zu", path->expanded);
+        return;
+    }
+    replyPrintf(r, "ok %zu %d %zu", path->numItems - 1, path->numCoins, path->expanded);
+    if (strcmp(extra, "path") == 0) {
+        pathCursor c;
+        for (pathBegin(&c, path); c.at < path->numItems; pathNext(&c)) {
+            replyPrintf(r, " (%d,%d)", c.cell.xpos, c.cell.ypos);
+        }
+    }
+}
+
+/* Read one request from fd and write its reply. Returns false if the
+   connection is finished: closed by the client, broken, or timed out. */
+static bool serveRequest(const mazeServer *srv, int fd, searchState *ss, stack *path, replyBuf *r) {
+    char req[SERVER_MAX_REQUEST + 1];
+    uint32_t len;
+
+    if (!readFull(fd, &len, sizeof(len))) {
+        return false;
+    }
+    len = ntohl(len);
+    if (len > SERVER_MAX_REQUEST || !readFull(fd, req, len)) {
+        return false;
+    }
+    req[len] = '\0';
+
+    r->len = sizeof(uint32_t);
+    handleRequest(srv, req, ss, path, r);
+    uint32_t replyLen = htonl((uint32_t)(r->len - sizeof(uint32_t)));
+    memcpy(r->data, &replyLen, sizeof(replyLen));
+    return writeFull(fd, r->data, r->len);
+}
+
+static void pushReady(mazeServer *srv, int fd) {
+    pthread_mutex_lock(&srv->readyLock);
+    if (srv->readyCount == srv->readySize) {
+        size_t newSize = srv->readySize ? srv->readySize * 2 : 64;
+        int *ready = (int*)malloc(sizeof(int) * newSize);
+        if (ready == NULL) {
+            fprintf(stderr, "Unable to queue %zu connections.\n", newSize);
+            exit(-1);
+        }
+        for (size_t i = 0; i < srv->readyCount; i++) {
+            ready[i] = srv->ready[(srv->readyHead + i) % srv->readySize];
+        }
+        free(srv->ready);
+        srv->ready = ready;
+        srv->readyHead = 0;
+        srv->readySize = newSize;
+    }
+    srv->ready[(srv->readyHead + srv->readyCount++) % srv->readySize] = fd;
+    pthread_cond_signal(&srv->readyCond);
+    pthread_mutex_unlock(&srv->readyLock);
+}
+
+static int popReady(mazeServer *srv) {
+    pthread_mutex_lock(&srv->readyLock);
+    while (srv->readyCount == 0) {
+        pthread_cond_wait(&srv->readyCond, &srv->readyLock);
+    }
+    int fd = srv->ready[srv->readyHead];
+    srv->readyHead = (srv->readyHead + 1) % srv->readySize;
+    srv->readyCount--;
+    pthread_mutex_unlock(&srv->readyLock);
+    return fd;
+}
+
+static void *serverWorkerMain(void *arg) {
+    mazeServer *srv = (mazeServer*)arg;
+    searchState ss;
+    stack path;
+    replyBuf r;
+
+    searchInit(&ss);
+    init(&path);
+    r.size = 256;
+    r.data = (char*)malloc(r.size);
+    if (r.data == NULL) {
+        fprintf(stderr, "Unable to allocate a reply buffer.\n");
+        exit(-1);
+    }
+
+    for (;;) {
+        int fd = popReady(srv);
+        /* a write this small to a pipe is atomic, so workers don't interleave */
+        if (!serveRequest(srv, fd, &ss, &path, &r)
+            || write(srv->handBack[1], &fd, sizeof(fd)) != (ssize_t)sizeof(fd)) {
+            close(fd);
+        }
+    }
+    return NULL;
+}
+
+/* add fd to the poll set, growing it as needed */
+static void pollAdd(struct pollfd **fds, size_t *count, size_t *size, int fd) {
+    if (*count == *size) {
+        *size *= 2;
+        *fds = (struct pollfd*)realloc(*fds, sizeof(struct pollfd) * *size);
+        if (*fds == NULL) {
+            fprintf(stderr, "Unable to poll %zu connections.\n", *size);
+            exit(-1);
+        }
+    }
+    (*fds)[*count].fd = fd;
+    (*fds)[*count].events = POLLIN;
+    (*fds)[*count].revents = 0;
+    (*count)++;
+}
+
+/* Wait on the hand-back pipe, the listening socket and every idle
+   connection. A connection with something to read (or hung up) leaves the
+   set and goes to the workers until one hands it back. */
+static void *serverPollerMain(void *arg) {
+    mazeServer *srv = (mazeServer*)arg;
+    size_t count = 0, size = 64;
+    struct pollfd *fds = (struct pollfd*)malloc(sizeof(struct pollfd) * size);
+    struct timeval timeout = { SERVER_IO_TIMEOUT, 0 };
+    int back[64];
+
+    if (fds == NULL) {
+        fprintf(stderr, "Unable to allocate the poll set.\n");
+        exit(-1);
+    }
+    pollAdd(&fds, &count, &size, srv->handBack[0]);
+    pollAdd(&fds, &count, &size, srv->listenFd);
+
+    for (;;) {
+        if (poll(fds, (nfds_t)count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        /* new and handed-back connections go after the ones examined here */
+        for (size_t i = 2; i < count; ) {
+            if (fds[i].revents != 0) {
+                pushReady(srv, fds[i].fd);
+                fds[i] = fds[--count];
+            } else {
+                i++;
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            ssize_t got = read(srv->handBack[0], back, sizeof(back));
+            for (ssize_t n = 0; n < got / (ssize_t)sizeof(int); n++) {
+                pollAdd(&fds, &count, &size, back[n]);
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            int fd = accept(srv->listenFd, NULL, NULL);
+            if (fd >= 0) {
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                pollAdd(&fds, &count, &size, fd);
+            }
+        }
+    }
+
+    free(fds);
+    return NULL;
+}
+
+/* the maze name clients use: the file name without directory or extension */
+static void residentName(const char *fname, char *name, size_t size) {
+    const char *base = strrchr(fname, '/');
+    base = base ? base + 1 : fname;
+    const char *dot = strrchr(base, '.');
+    size_t n = dot && dot != base ? (size_t)(dot - base) : strlen(base);
+    if (n >= size) {
+        n = size - 1;
+    }
+    memcpy(name, base, n);
+    name[n] = '\0';
+}
+
+/* returns a socket listening on path, or -1 */
+static int listenOn(const char *path) {
+    struct sockaddr_un addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Socket path is too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SERVER_BACKLOG) != 0) {
+        printf("Can't listen on %s: %s\n", path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+static void freeResidents(mazeServer *srv) {
+    for (int i = 0; i < srv->numMazes; i++) {
+        freeMaze(&srv->mazes[i].m1);
+    }
+    free(srv->mazes);
+}
+
+/* Load every input, then serve requests on opts->socketPath until SIGINT or SIGTERM. */
+int runServer(char **inputs, int numInputs, runOptions *opts) {
+    /* static: the detached threads keep using it until the process exits */
+    static mazeServer srv;
+
+    /* requests run concurrently against one shared maze, which a sparse
+       maze's lookups and a tile file's cache are not built for */
+    if (opts->sparse || opts->tileFile != NULL) {
+        printf("The server keeps its mazes in memory: -z and -D can't be used with -S.\n");
+        return -1;
+    }
+
+    memset(&srv, 0, sizeof(srv));
+    srv.mazes = (residentMaze*)calloc((size_t)numInputs, sizeof(residentMaze));
+    if (srv.mazes == NULL) {
+        printf("Unable to allocate the maze table.\n");
+        return -1;
+    }
+    for (int i = 0; i < numInputs; i++) {
+        residentMaze *rm = &srv.mazes[srv.numMazes];
+        residentName(inputs[i], rm->name, sizeof(rm->name));
+        if (findResident(&srv, rm->name) != NULL) {
+            printf("Skipping %s: a maze named %s is already loaded\n", inputs[i], rm->name);
+            continue;
+        }
+        rm->m1.packed = opts->packed;
+        rm->m1.tiled = opts->tiled;
+        rm->m1.out = stdout;
+        printf("Loading %s as %s\n", inputs[i], rm->name);
+        if (loadMaze(inputs[i], &rm->m1)) {
+            srv.numMazes++;
+        }
+    }
+
+    if (srv.numMazes == 0) {
+        printf("No mazes to serve.\n");
+        freeResidents(&srv);
+        return -1;
+    }
+    srv.listenFd = listenOn(opts->socketPath);
+    if (srv.listenFd < 0) {
+        freeResidents(&srv);
+        return -1;
+    }
+    if (pipe(srv.handBack) != 0) {
+        printf("Can't create the server's pipe: %s\n", strerror(errno));
+        close(srv.listenFd);
+        freeResidents(&srv);
+        return -1;
+    }
+    pthread_mutex_init(&srv.readyLock, NULL);
+    pthread_cond_init(&srv.readyCond, NULL);
+
+    int workers = opts->workers;
+    if (workers < 1) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = online > 0 ? (int)online : 1;
+    }
+
+    /* only this thread takes the shutdown signals */
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, NULL);
+
+    pthread_t *tids = (pthread_t*)malloc(sizeof(pthread_t) * ((size_t)workers + 1));
+    for (int t = 0; t < workers; t++) {
+        pthread_create(&tids[t], NULL, serverWorkerMain, &srv);
+        pthread_detach(tids[t]);
+    }
+    pthread_create(&tids[workers], NULL, serverPollerMain, &srv);
+    pthread_detach(tids[workers]);
+    printf("Serving %d maze%s on %s with %d workers\n", srv.numMazes, srv.numMazes == 1 ? "" : "s",
+           opts->socketPath, workers);
+    fflush(stdout);
+
+    int sig;
+    sigwait(&stopSignals, &sig);
+    printf("Stopping on signal %d\n", sig);
+    unlink(opts->socketPath);
+    free(tids);
+
+    /* workers may still be inside a request, so the mazes are left to the exit */
+    return 0;
+}
+
+// incremental re-solve ======================================================
+
+/* Apply one "x y b" / "x y c" edit, or with remove its "x y -b" / "x y -c"
+   inverse. Edits are checked like obstacle lines; returns a lineError. */
+int applyEdit(maze *m1, long xpos, long ypos, char type, bool remove) {
+    int err = errorCheck(m1, xpos, ypos);
+    if (err != LINE_OK) {
+        return err;
+    }
+
+    char cur = cellChar(m1, (int)xpos, (int)ypos);
+    switch (type) {
+        case 'b' :
+            if (!remove) {
+                setCell(m1, (int)xpos, (int)ypos, '*');
+            } else if (cur == '*') {
+                setCell(m1, (int)xpos, (int)ypos, '.');
+            }
+            break;
+        case 'c' :
+            if (!remove) {
+                setCell(m1, (int)xpos, (int)ypos, 'C');
+            } else if (cur == 'C') {
+                setCell(m1, (int)xpos, (int)ypos, '.');
+            }
+            break;
+        default :
+            return LINE_BAD_TYPE;
+    }
+    return LINE_OK;
+}
+
+/* a binary maze's walls point into a read-only mapping; give it its own copy before editing */
+static bool ownGrid(maze *m1) {
+    if (m1->mapBase == NULL) {
+        return true;
+    }
+    size_t bytes = (numCells(m1) / 8 + CACHE_LINE-1) & ~(size_t)(CACHE_LINE-1);
+    uint64_t *walls = (uint64_t*)aligned_alloc(CACHE_LINE, bytes);
+    if (walls == NULL) {
+        return false;
+    }
+    memcpy(walls, m1->walls, numCells(m1) / 8);
+    munmap(m1->mapBase, m1->mapLen);
+    m1->mapBase = NULL;
+    m1->walls = walls;
+    return true;
+}
+
+static void countPathCoins(const maze *m1, stack *path) {
+    pathCursor c;
+    path->numCoins = 0;
+    for (pathBegin(&c, path); c.at < path->numItems; pathNext(&c)) {
+        if (hasCoin(m1, cellIndex(m1, c.cell.xpos, c.cell.ypos))) {
+            path->numCoins++;
+        }
+    }
+}
+
+/* Mend a path that edits have walled over. The first and last walled cells
+   split it into a prefix and a suffix. A BFS from the end of the prefix,
+   kept out of the prefix so no loop forms, runs to the nearest suffix cell
+   and that detour is spliced in. Returns 0 if no detour exists, which
+   does not prove the maze unsolvable: only the prefix was fixed, or -1 if
+   it ran out of memory. */
+static int repairPath(const maze *m1, stack *path, searchState *ss, size_t *brokenAt) {
+    size_t first = path->numItems, last = 0;
+    coord from = path->first;
+    pathCursor c;
+
+    for (pathBegin(&c, path); c.at < path->numItems; pathNext(&c)) {
+        if (isWall(m1, cellIndex(m1, c.cell.xpos, c.cell.ypos))) {
+            first = c.at < first ? c.at : first;
+            last = c.at;
+        }
+    }
+    *brokenAt = first;
+    if (first == path->numItems) {
+        return 1;
+    }
+
+    /* start and end can't be walled, so both halves are non-empty */
+    coinSet suffix;
+    memset(&suffix, 0, sizeof(suffix));
+    if (!searchBegin(ss, m1)) {
+        return outOfMemory(m1, "the search state");
+    }
+    for (pathBegin(&c, path); c.at < path->numItems; pathNext(&c)) {
+        if (c.at < first) {
+            markVisited(ss, cellIndex(m1, c.cell.xpos, c.cell.ypos));
+            from = c.cell;
+        } else if (c.at > last) {
+            coinAdd(&suffix, cellIndex(m1, c.cell.xpos, c.cell.ypos));
+        }
+    }
+
+    size_t hit = 0;
+    bool found = false;
+    cellQueue q;
+    if (!queueInit(&q, 64)) {
+        coinFree(&suffix);
+        return outOfMemory(m1, "the search queue");
+    }
+    queuePush(&q, cellIndex(m1, from.xpos, from.ypos));
+    while (q.count > 0 && !q.failed && !found) {
+        size_t idx = queuePop(&q);
+        unsigned open = openDirs(m1, cellRow(m1, idx), cellCol(m1, idx));
+        path->expanded++;
+        for (int dir = 0; dir < 4 && !found; dir++) {
+            size_t next = stepCell(m1, idx, dir);
+            if (!(open >> dir & 1) || isVisited(ss, next)) {
+                continue;
+            }
+            markVisited(ss, next);
+            setParentDir(ss->parent, next, dir);
+            if (coinHas(&suffix, next)) {
+                hit = next;
+                found = true;
+            }
+            queuePush(&q, next);
+        }
+    }
+    free(q.items);
+    coinFree(&suffix);
+    if (q.failed) {
+        return outOfMemory(m1, "the search queue");
+    }
+    if (!found) {
+        return 0;
+    }
+
+    /* prefix, then the detour, then the suffix from the cell the detour reached */
+    stack fixed;
+    maze detour = *m1;
+    bool joined = false, grown = true;
+    init(&fixed);
+    detour.xstart = from.xpos;
+    detour.ystart = from.ypos;
+    detour.xend = cellRow(m1, hit);
+    detour.yend = cellCol(m1, hit);
+    for (pathBegin(&c, path); grown && c.at < path->numItems; pathNext(&c)) {
+        if (c.at < first || (c.at > last && joined)) {
+            grown = push(&fixed, c.cell.xpos, c.cell.ypos, false) != NULL;
+        } else if (c.at > last && cellIndex(m1, c.cell.xpos, c.cell.ypos) == hit) {
+            grown = buildPath(&detour, ss->parent, &fixed);
+            joined = true;
+        }
+    }
+    if (!grown) {
+        clear(&fixed, false);
+        return outOfMemory(m1, "the path stack");
+    }
+
+    fixed.expanded = path->expanded;
+    fixed.out = path->out;
+    free(path->steps);
+    *path = fixed;
+    return 1;
+}
+
+static const char* nextEditLine(const char* p, const char* end, const char** line) {
+    *line = skipBlanks(p, end);
+    return nextLine(*line, end);
+}
+
+/* Load one maze, solve it, then apply the edits in opts->editFile. A line
+   "solve" ends a batch of edits (so does the end of the file); after each
+   batch the previous path is repaired rather than solved again, and the
+   work this took is compared with a full re-solve. */
+int runEdits(const char *fname, runOptions *opts) {
+    maze m1;
+    mazeSource src;
+    searchState ss;
+    stack path;
+    int found;
+
+    memset(&m1, 0, sizeof(m1));
+    m1.packed = opts->packed;
+    m1.tiled = opts->tiled;
+    m1.out = stdout;
+    if (!loadMaze(fname, &m1)) {
+        return -1;
+    }
+    if (!ownGrid(&m1) || !openSource(opts->editFile, &src)) {
+        printf("Can't open edit file: %s\n", opts->editFile);
+        freeMaze(&m1);
+        return -1;
+    }
+
+    searchInit(&ss);
+    init(&path);
+    path.out = stdout;
+    found = solveMaze(&m1, &path, &ss, opts);
+    if (found > 0) {
+        printf("Initial solve: %zu steps, %d coins, %zu cells expanded\n",
+               path.numItems - 1, path.numCoins, path.expanded);
+    } else if (found == 0) {
+        printf("Initial solve: no solution, %zu cells expanded\n", path.expanded);
+    }
+
+    const char *p = src.pos, *end = src.end;
+    int batch = 0;
+    while (p < end && found >= 0) {
+        size_t errors[NUM_LINE_ERRORS] = {0};
+        size_t applied = 0;
+        bool opened = false;
+
+        /* apply edits up to the next "solve" line */
+        while (p < end) {
+            const char *line;
+            const char *rest = nextEditLine(p, end, &line);
+            const char *c = line;
+            long xpos, ypos;
+
+            p = rest;
+            if (line == end || *line == '\n') {
+                continue;
+            }
+            if (strncmp(line, "solve", 5) == 0) {
+                break;
+            }
+            if (!scanInt(&c, rest, &xpos) || !scanInt(&c, rest, &ypos)) {
+                errors[LINE_MALFORMED]++;
+                continue;
+            }
+            c = skipBlanks(c, rest);
+            bool remove = (c < rest && *c == '-');
+            c += remove;
+            char type = (c < rest) ? *c : '\n';
+
+            bool wasWall = xpos >= 1 && xpos <= m1.xsize && ypos >= 1 && ypos <= m1.ysize
+                           && isWall(&m1, cellIndex(&m1, (int)xpos, (int)ypos));
+            int err = applyEdit(&m1, xpos, ypos, type, remove);
+            errors[err]++;
+            if (err == LINE_OK) {
+                applied++;
+                opened |= wasWall && !isWall(&m1, cellIndex(&m1, (int)xpos, (int)ypos));
+            }
+        }
+        batch++;
+        printf("Edit batch %d: %zu edits applied\n", batch, applied);
+        reportLineErrors(&m1, errors);
+
+        /* repair: a valid path stays valid unless walled over; with no
+           path, only an opened wall can make the maze solvable */
+        size_t brokenAt = path.numItems;
+        double t0 = nowSeconds();
+        path.expanded = 0;
+        if (found) {
+            found = repairPath(&m1, &path, &ss, &brokenAt);
+        }
+        if (!found && (opened || brokenAt < path.numItems)) {
+            size_t spent = path.expanded;
+            clear(&path, false);
+            path.out = stdout;
+            found = solveMaze(&m1, &path, &ss, opts);
+            path.expanded += spent;
+            brokenAt = 0;
+        }
+        double repairTime = nowSeconds() - t0;
+
+        if (found < 0) {
+            break;
+        } else if (!found) {
+            printf("This maze has no solution.\n");
+        } else {
+            countPathCoins(&m1, &path);
+            if (brokenAt == path.numItems) {
+                printf("Path kept: no edit walled it over.\n");
+            } else if (brokenAt == 0) {
+                printf("Path solved again from the start.\n");
+            } else {
+                printf("Path repaired from step %zu.\n", brokenAt);
+            }
+            printf("The amount of coins collected: %d\n", path.numCoins);
+            printf("Path length: %zu steps\n", path.numItems - 1);
+            printf("The path from start to end: \n");
+            fflush(stdout);
+            if (opts->runLengths) {
+                printRunLengths(&path);
+            } else {
+                printReverse(&path);
+            }
+            printf("\n");
+        }
+
+        /* measure what a from-scratch solve would have cost */
+        stack full;
+        init(&full);
+        full.out = stdout;
+        t0 = nowSeconds();
+        if (solveMaze(&m1, &full, &ss, opts) < 0) {
+            clear(&full, false);
+            found = -1;
+            break;
+        }
+        double fullTime = nowSeconds() - t0;
+        printf("Cells expanded: %zu, a full re-solve expands %zu (%.1f%% avoided); %.1f us vs %.1f us\n",
+               path.expanded, full.expanded,
+               full.expanded ? 100.0 * (1.0 - (double)path.expanded / (double)full.expanded) : 0.0,
+               repairTime * 1e6, fullTime * 1e6);
+        clear(&full, false);
+
+        if (found && opts->showPath) {
+            outBuf ob;
+            obInit(&ob, stdout);
+            renderMaze(&m1, &path, &ob);
+            obFlush(&ob);
+        }
+    }
+
+    closeSource(&src);
+    clear(&path, false);
+    searchFree(&ss);
+    freeMaze(&m1);
+    return found < 0 ? -1 : 0;
+}
@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+
+/* This program talks to a maze server (maze -S <socket> ...). It can send
+   a single request and print the reply, or act as a load generator that
+   keeps several connections busy with random solve requests and reports
+   latency percentiles. Messages are a 4-byte length in network byte order
+   followed by the text of the request or reply. */
+
+#define DEFAULT_SOCKET "maze.sock"
+#define MAX_REQUEST 4096
+
+typedef struct loadOptions {
+    const char *socketPath;
+    const char *mazeName;
+    const char *algorithm;
+    long requests;
+    int connections;
+    uint64_t seed;
+} loadOptions;
+
+/* one connection of the load generator and the latencies it measured */
+typedef struct loadWorker {
+    const loadOptions *opts;
+    int xsize, ysize;
+    long first, count;      /* this worker's share of the requests */
+    uint64_t rng;
+    double *latency;        /* seconds, one per request that reached a solver */
+    long ok, none, errors;
+    bool failed;
+} loadWorker;
+
+int connectTo(const char *path);
+bool sendRequest(int fd, const char *req);
+char *readReply(int fd);
+int runOnce(const char *socketPath, const char *req);
+int runLoad(loadOptions *opts);
+
+int main (int argc, char **argv) {
+    loadOptions opts = { .socketPath = DEFAULT_SOCKET, .mazeName = NULL, .algorithm = "bfs",
+                         .requests = 10000, .connections = 4, .seed = 1 };
+    bool load = false, info = false;
+    char req[MAX_REQUEST];
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i+1 < argc) {
+            opts.socketPath = argv[++i];
+        } else if (strcmp(argv[i], "-L") == 0) {
+            load = true;
+        } else if (strcmp(argv[i], "-i") == 0) {
+            info = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i+1 < argc) {
+            opts.requests = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i+1 < argc) {
+            opts.connections = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-a") == 0 && i+1 < argc) {
+            opts.algorithm = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && i+1 < argc) {
+            opts.seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            break;
+        }
+    }
+
+    int rest = argc - i;
+    if ((load || info) ? rest != 1 : (rest < 5 || rest > 7)) {
+        printf("Usage: %s [-s socket] <maze> <x1> <y1> <x2> <y2> [dfs|bfs|astar|jps|bidir] [path]\n", argv[0]);
+        printf("       %s [-s socket] -i <maze>\n", argv[0]);
+        printf("       %s [-s socket] -L [-n requests] [-c connections] [-a algorithm] [-r seed] <maze>\n", argv[0]);
+        exit(-1);
+    }
+
+    if (load) {
+        opts.mazeName = argv[i];
+        if (opts.requests < 1 || opts.connections < 1) {
+            printf("The request and connection counts must be at least 1.\n");
+            exit(-1);
+        }
+        return runLoad(&opts) == 0 ? 0 : 1;
+    }
+
+    if (info) {
+        snprintf(req, sizeof(req), "info %s", argv[i]);
+    } else {
+        size_t len = (size_t)snprintf(req, sizeof(req), "solve");
+        for (; i < argc && len < sizeof(req); i++) {
+            len += (size_t)snprintf(req + len, sizeof(req) - len, " %s", argv[i]);
+        }
+    }
+    return runOnce(opts.socketPath, req) == 0 ? 0 : 1;
+}
+
+// protocol ==================================================================
+
+int connectTo(const char *path) {
+    struct sockaddr_un addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool readFull(int fd, void *buf, size_t n) {
+    char *p = (char*)buf;
+    while (n > 0) {
+        ssize_t got = read(fd, p, n);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        p += got;
+        n -= (size_t)got;
+    }
+    return true;
+}
+
+/* the length and the text go out in one write */
+bool sendRequest(int fd, const char *req) {
+    char msg[sizeof(uint32_t) + MAX_REQUEST];
+    size_t len = strlen(req);
+    uint32_t hdr = htonl((uint32_t)len);
+
+    if (len > MAX_REQUEST) {
+        return false;
+    }
+    memcpy(msg, &hdr, sizeof(hdr));
+    memcpy(msg + sizeof(hdr), req, len);
+    len += sizeof(hdr);
+
+    const char *p = msg;
+    while (len > 0) {
+        ssize_t put = send(fd, p, len, MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR) {
+            continue;
+        }
+        if (put <= 0) {
+            return false;
+        }
+        p += put;
+        len -= (size_t)put;
+    }
+    return true;
+}
+
+/* returns the reply as a string the caller frees, or NULL if the connection failed */
+char *readReply(int fd) {
+    uint32_t len;
+
+    if (!readFull(fd, &len, sizeof(len))) {
+        return NULL;
+    }
+    len = ntohl(len);
+    char *reply = (char*)malloc((size_t)len + 1);
+    if (reply == NULL || !readFull(fd, reply, len)) {
+        free(reply);
+        return NULL;
+    }
+    reply[len] = '\0';
+    return reply;
+}
+
+int runOnce(const char *socketPath, const char *req) {
+    int fd = connectTo(socketPath);
+    if (fd < 0) {
+        printf("Can't connect to %s\n", socketPath);
+        return -1;
+    }
+
+    char *reply = sendRequest(fd, req) ? readReply(fd) : NULL;
+    close(fd);
+    if (reply == NULL) {
+        printf("No reply from %s\n", socketPath);
+        return -1;
+    }
+    printf("%s\n", reply);
+    int status = strncmp(reply, "error", 5) == 0 ? -1 : 0;
+    free(reply);
+    return status;
+}
+
+// load generator ============================================================
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, as in mazeGen */
+static uint64_t nextRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static int randomCoord(uint64_t *rng, int size) {
+    return 1 + (int)(nextRandom(rng) % (uint64_t)size);
+}
+
+/* Send this worker's share of the requests one after another on its own
+   connection, timing each from send to complete reply. Endpoints are
+   uniform over the maze, so some land on walls and come back as errors at
+   once; only "ok" and "none" replies, which ran a search, are timed. */
+static void *loadWorkerMain(void *arg) {
+    loadWorker *w = (loadWorker*)arg;
+    char req[MAX_REQUEST];
+
+    int fd = connectTo(w->opts->socketPath);
+    if (fd < 0) {
+        w->failed = true;
+        return NULL;
+    }
+    for (long n = 0; n < w->count; n++) {
+        snprintf(req, sizeof(req), "solve %s %d %d %d %d %s", w->opts->mazeName,
+                 randomCoord(&w->rng, w->xsize), randomCoord(&w->rng, w->ysize),
+                 randomCoord(&w->rng, w->xsize), randomCoord(&w->rng, w->ysize), w->opts->algorithm);
+
+        double t0 = nowSeconds();
+        char *reply = sendRequest(fd, req) ? readReply(fd) : NULL;
+        double elapsed = nowSeconds() - t0;
+        if (reply == NULL) {
+            w->failed = true;
+            break;
+        }
+        if (strncmp(reply, "ok", 2) == 0 || strncmp(reply, "none", 4) == 0) {
+            w->latency[w->first + w->ok + w->none] = elapsed;
+            if (reply[0] == 'o') {
+                w->ok++;
+            } else {
+                w->none++;
+            }
+        } else {
+            w->errors++;
+        }
+        free(reply);
+    }
+    close(fd);
+    return NULL;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, long n, double p) {
+    long i = (long)(p * (double)(n - 1) + 0.5);
+    return sorted[i];
+}
+
+int runLoad(loadOptions *opts) {
+    char req[MAX_REQUEST];
+    int xsize, ysize;
+
+    /* the maze size picks the range of the random endpoints */
+    int fd = connectTo(opts->socketPath);
+    if (fd < 0) {
+        printf("Can't connect to %s\n", opts->socketPath);
+        return -1;
+    }
+    snprintf(req, sizeof(req), "info %s", opts->mazeName);
+    char *reply = sendRequest(fd, req) ? readReply(fd) : NULL;
+    close(fd);
+    if (reply == NULL || sscanf(reply, "ok %d %d", &xsize, &ysize) != 2) {
+        printf("Can't get the size of %s: %s\n", opts->mazeName, reply ? reply : "no reply");
+        free(reply);
+        return -1;
+    }
+    free(reply);
+
+    double *latency = (double*)calloc((size_t)opts->requests, sizeof(double));
+    loadWorker *workers = (loadWorker*)calloc((size_t)opts->connections, sizeof(loadWorker));
+    pthread_t *tids = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)opts->connections);
+    if (latency == NULL || workers == NULL || tids == NULL) {
+        printf("Unable to allocate %ld latency samples.\n", opts->requests);
+        exit(-1);
+    }
+
+    long share = opts->requests / opts->connections, extra = opts->requests % opts->connections;
+    long first = 0;
+    for (int c = 0; c < opts->connections; c++) {
+        workers[c].opts = opts;
+        workers[c].xsize = xsize;
+        workers[c].ysize = ysize;
+        workers[c].first = first;
+        workers[c].count = share + (c < extra);
+        workers[c].rng = (opts->seed + (uint64_t)c) * 0x9E3779B97F4A7C15ULL + 1;
+        workers[c].latency = latency;
+        first += workers[c].count;
+    }
+
+    double t0 = nowSeconds();
+    for (int c = 0; c < opts->connections; c++) {
+        pthread_create(&tids[c], NULL, loadWorkerMain, &workers[c]);
+    }
+    long ok = 0, none = 0, errors = 0;
+    bool failed = false;
+    for (int c = 0; c < opts->connections; c++) {
+        pthread_join(tids[c], NULL);
+        ok += workers[c].ok;
+        none += workers[c].none;
+        errors += workers[c].errors;
+        failed |= workers[c].failed;
+    }
+    double elapsed = nowSeconds() - t0;
+
+    /* gather the timed requests; errors and a failed connection's unsent share left gaps */
+    long done = ok + none + errors, timed = 0;
+    for (int c = 0; c < opts->connections; c++) {
+        long got = workers[c].ok + workers[c].none;
+        memmove(latency + timed, latency + workers[c].first, sizeof(double) * (size_t)got);
+        timed += got;
+    }
+    if (done == 0) {
+        printf("No requests completed.\n");
+        return -1;
+    }
+
+    printf("%ld requests on %d connections in %.3f s: %.0f req/s\n",
+           done, opts->connections, elapsed, (double)done / elapsed);
+    printf("replies: %ld ok, %ld no path, %ld errors\n", ok, none, errors);
+    if (timed > 0) {
+        qsort(latency, (size_t)timed, sizeof(double), compareDoubles);
+        printf("solve latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+               percentile(latency, timed, 0.50) * 1e6, percentile(latency, timed, 0.90) * 1e6,
+               percentile(latency, timed, 0.99) * 1e6, percentile(latency, timed, 0.999) * 1e6,
+               latency[timed - 1] * 1e6);
+    }
+    if (failed) {
+        printf("Some connections failed before finishing.\n");
+    }
+
+    free(latency);
+    free(workers);
+    free(tids);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+
+/* This program writes a maze in the mazeData format: the size, start and
+   end lines followed by one "x y b" (wall) or "x y c" (coin) line per
+   obstacle. It is used to make inputs of any size for benchmarking. */
+
+enum mazeKind {
+    GEN_RANDOM,         /* independent walls at the given density */
+    GEN_PERFECT,        /* a spanning tree of corridors: exactly one route between any two cells */
+    GEN_OPEN,           /* no walls at all */
+    GEN_SERPENTINE      /* one long snaking corridor that the depth-first walk explores before the short route */
+};
+
+typedef struct genOptions {
+    enum mazeKind kind;
+    int xsize, ysize;
+    double wallDensity;
+    double coinDensity;
+    uint64_t seed;
+} genOptions;
+
+uint64_t nextRandom(uint64_t *state);
+double randomUnit(uint64_t *state);
+void writeHeader(int xsize, int ysize, int xstart, int ystart, int xend, int yend);
+void writeObstacle(int x, int y, char type);
+void genRandom(genOptions *opts, uint64_t *rng);
+void genPerfect(genOptions *opts, uint64_t *rng);
+void genSerpentine(genOptions *opts, uint64_t *rng);
+
+int main (int argc, char **argv) {
+    genOptions opts = { .kind = GEN_RANDOM, .xsize = 100, .ysize = 100,
+                        .wallDensity = 0.25, .coinDensity = 0.01, .seed = 1 };
+    uint64_t rng;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i+1 < argc) {
+            i++;
+            if (strcmp(argv[i], "random") == 0) {
+                opts.kind = GEN_RANDOM;
+            } else if (strcmp(argv[i], "perfect") == 0) {
+                opts.kind = GEN_PERFECT;
+            } else if (strcmp(argv[i], "open") == 0) {
+                opts.kind = GEN_OPEN;
+            } else if (strcmp(argv[i], "serpentine") == 0) {
+                opts.kind = GEN_SERPENTINE;
+            } else {
+                printf("Unknown maze type: %s\n", argv[i]);
+                exit(-1);
+            }
+        } else if (strcmp(argv[i], "-x") == 0 && i+1 < argc) {
+            opts.xsize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-y") == 0 && i+1 < argc) {
+            opts.ysize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i+1 < argc) {
+            opts.wallDensity = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-k") == 0 && i+1 < argc) {
+            opts.coinDensity = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i+1 < argc) {
+            opts.seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            printf("Usage: %s [-t random|perfect|open|serpentine] [-x rows] [-y cols]\n", argv[0]);
+            printf("       [-w wall density] [-k coin density] [-s seed]\n");
+            exit(-1);
+        }
+    }
+
+    if (opts.xsize < 2 || opts.ysize < 2) {
+        printf("Maze sizes must be at least 2.\n");
+        exit(-1);
+    }
+
+    /* large obstacle lists: let stdio batch the writes */
+    setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+    rng = opts.seed * 0x9E3779B97F4A7C15ULL + 1;
+
+    switch (opts.kind) {
+        case GEN_PERFECT :
+            genPerfect(&opts, &rng);
+            break;
+        case GEN_SERPENTINE :
+            genSerpentine(&opts, &rng);
+            break;
+        case GEN_OPEN :
+            opts.wallDensity = 0;
+            genRandom(&opts, &rng);
+            break;
+        default :
+            genRandom(&opts, &rng);
+    }
+
+    fflush(stdout);
+    return 0;
+}
+
+// output ====================================================================
+
+/* xorshift64*: small, fast and good enough for placing walls */
+uint64_t nextRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+double randomUnit(uint64_t *state) {
+    return (double)(nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void writeHeader(int xsize, int ysize, int xstart, int ystart, int xend, int yend) {
+    printf("%d %d\n%d %d\n%d %d\n", xsize, ysize, xstart, ystart, xend, yend);
+}
+
+void writeObstacle(int x, int y, char type) {
+    printf("%d %d %c\n", x, y, type);
+}
+
+// maze shapes ===============================================================
+
+void genRandom(genOptions *opts, uint64_t *rng) {
+    int x, y;
+
+    writeHeader(opts->xsize, opts->ysize, 1, 1, opts->xsize, opts->ysize);
+    for (x = 1; x <= opts->xsize; x++) {
+        for (y = 1; y <= opts->ysize; y++) {
+            if ((x == 1 && y == 1) || (x == opts->xsize && y == opts->ysize)) {
+                continue;
+            }
+            double r = randomUnit(rng);
+            if (r < opts->wallDensity) {
+                writeObstacle(x, y, 'b');
+            } else if (r < opts->wallDensity + opts->coinDensity) {
+                writeObstacle(x, y, 'c');
+            }
+        }
+    }
+}
+
+/* Recursive-backtracker maze carved on the odd cells, using an explicit
+   stack so large mazes don't overflow the C stack. Every cell left uncarved
+   becomes a wall; carved cells get coins at the coin density. */
+void genPerfect(genOptions *opts, uint64_t *rng) {
+    static const int dx[4] = { 2, 0, -2, 0 };
+    static const int dy[4] = { 0, 2, 0, -2 };
+    int xsize = opts->xsize, ysize = opts->ysize;
+    int xend = (xsize % 2) ? xsize : xsize-1;
+    int yend = (ysize % 2) ? ysize : ysize-1;
+    size_t width = (size_t)ysize + 1;
+    uint8_t *open = (uint8_t*)calloc(((size_t)xsize + 1) * width, 1);
+    int *stackX = (int*)malloc(sizeof(int) * ((size_t)xsize/2 + 1) * ((size_t)ysize/2 + 1));
+    int *stackY = (int*)malloc(sizeof(int) * ((size_t)xsize/2 + 1) * ((size_t)ysize/2 + 1));
+    size_t depth = 0;
+    int x, y;
+
+    if (open == NULL || stackX == NULL || stackY == NULL) {
+        printf("Unable to allocate a %d x %d maze.\n", xsize, ysize);
+        exit(-1);
+    }
+
+    open[1 * width + 1] = 1;
+    stackX[depth] = 1;
+    stackY[depth++] = 1;
+    while (depth > 0) {
+        x = stackX[depth-1];
+        y = stackY[depth-1];
+
+        int choices[4], numChoices = 0;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + dx[d], ny = y + dy[d];
+            if (nx >= 1 && nx <= xsize && ny >= 1 && ny <= ysize && !open[(size_t)nx * width + ny]) {
+                choices[numChoices++] = d;
+            }
+        }
+        if (numChoices == 0) {
+            depth--;
+            continue;
+        }
+
+        int d = choices[nextRandom(rng) % (uint64_t)numChoices];
+        open[(size_t)(x + dx[d]/2) * width + (y + dy[d]/2)] = 1;
+        open[(size_t)(x + dx[d]) * width + (y + dy[d])] = 1;
+        stackX[depth] = x + dx[d];
+        stackY[depth++] = y + dy[d];
+    }
+
+    writeHeader(xsize, ysize, 1, 1, xend, yend);
+    for (x = 1; x <= xsize; x++) {
+        for (y = 1; y <= ysize; y++) {
+            if (!open[(size_t)x * width + y]) {
+                writeObstacle(x, y, 'b');
+            } else if ((x != 1 || y != 1) && (x != xend || y != yend)
+                       && randomUnit(rng) < opts->coinDensity) {
+                writeObstacle(x, y, 'c');
+            }
+        }
+    }
+
+    free(stackX);
+    free(stackY);
+    free(open);
+}
+
+/* Start at (1,1), end at (1,ysize). Row 1 is a straight open route to the
+   end. Below it, every even row is a wall with one gap. The gaps alternate
+   between the left and right edges, starting under the start cell. This
+   makes one corridor that snakes through the whole grid. The solver tries +x
+   before +y, so the depth-first walk sweeps the entire serpentine before
+   backing out to the short route. */
+void genSerpentine(genOptions *opts, uint64_t *rng) {
+    int xsize = opts->xsize, ysize = opts->ysize;
+    int x, y;
+
+    writeHeader(xsize, ysize, 1, 1, 1, ysize);
+    for (x = 2; x <= xsize; x++) {
+        int gap = ((x / 2) % 2) ? 1 : ysize;
+        for (y = 1; y <= ysize; y++) {
+            if (x % 2 == 0 && y != gap) {
+                writeObstacle(x, y, 'b');
+            } else if (x % 2 == 1 && randomUnit(rng) < opts->coinDensity) {
+                writeObstacle(x, y, 'c');
+            }
+        }
+    }
+}